@@ -4,6 +4,7 @@ in vec2 uv;
 
 uniform int mode = 0;
 uniform float scalar = 1;
+uniform vec2 area = vec2(1, 1);
 uniform sampler2D intensity;
 uniform sampler2D palette;
 
@@ -13,12 +14,12 @@ void main()
 {
 	if (mode == 0)
 	{
-		vec2 index = texture(intensity, uv).rg * scalar;
+		vec2 index = texture(intensity, uv * area).rg * scalar;
 		color = texture(palette, index).rgb;
 	}
 	else if (mode == 1)
 	{
-		color = texture(intensity, uv).rrr * scalar;
+		color = texture(intensity, uv * area).rrr * scalar;
 	}
 	else if (mode == 2)
 	{
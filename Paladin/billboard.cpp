@@ -0,0 +1,240 @@
+#include "billboard.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "tdjx_jobs.h"
+#include "util.h"
+
+namespace tdjx
+{
+    namespace billboard
+    {
+        // sprites closer than this would blow up to fill the screen, they're dropped instead
+        const float32 kNearPlane = 0.1f;
+
+        // sprites moved to camera space per job
+        const int kTransformGrain = 256;
+
+        // columns per depth tile for the coarse cull, and per job when drawing
+        const int kTileColumns = 16;
+        const int kColumnBand = 16;
+
+        // a sprite in screen space, left and top aren't clipped so texels stay put as it slides off the screen
+        struct Projected
+        {
+            const gfx::ByteImage* image;
+            float32 depth;
+            float32 left, top;
+            float32 texelsPerColumn, texelsPerRow;
+            int x0, x1;
+            int y0, y1;
+        };
+
+        struct
+        {
+            std::vector<Projected> projected;
+            std::vector<uint8> visible;
+            std::vector<float32> tileDepth;
+            std::vector<uint32> keys, values;
+            std::vector<uint32> scratchKeys, scratchValues;
+        } g_billboard;
+
+        namespace sprites
+        {
+            int add(Sprites& self, float32 x, float32 y, float32 size, gfx::ImageHandle image)
+            {
+                self.x.push_back(x);
+                self.y.push_back(y);
+                self.size.push_back(size);
+                self.image.push_back(image);
+                return static_cast<int>(self.x.size()) - 1;
+            }
+
+            void clear(Sprites& self)
+            {
+                self.x.clear();
+                self.y.clear();
+                self.size.clear();
+                self.image.clear();
+            }
+
+            int get_count(const Sprites& self)
+            {
+                return static_cast<int>(self.x.size());
+            }
+        }
+
+        // furthest wall in each tile of columns, a sprite closer than that in none of its tiles can't show anywhere
+        void update_tile_depth(const raycast::Hits& hits, int columns)
+        {
+            int tiles = (columns + kTileColumns - 1) / kTileColumns;
+            g_billboard.tileDepth.assign(tiles, 0.0f);
+            for (int x = 0; x < columns; ++x)
+            {
+                float32& depth = g_billboard.tileDepth[x / kTileColumns];
+                depth = std::max(depth, hits.distance[x]);
+            }
+        }
+
+        bool try_project(const Sprites& sprites, int index, const Camera& camera, const math::Rect<int>& area,
+            float32 invDet, float32 columnsPerCell, float32 rowsPerCell, int columns, int height, Projected& out)
+        {
+            const gfx::ByteImage* image = gfx::get_image(sprites.image[index]);
+            if (!image || image->width <= 0 || image->height <= 0)
+            {
+                return false;
+            }
+
+            float32 rx = sprites.x[index] - camera.x;
+            float32 ry = sprites.y[index] - camera.y;
+            float32 depth = invDet * (camera.planeX * ry - camera.planeY * rx);
+            if (depth < kNearPlane)
+            {
+                return false;
+            }
+            float32 across = invDet * (camera.dirY * rx - camera.dirX * ry);
+
+            // same scale as the walls, a cell is rowsPerCell / depth tall with the floor half of that below the middle
+            float32 size = sprites.size[index];
+            float32 screenHeight = size * rowsPerCell / depth;
+            float32 screenWidth = size * columnsPerCell / depth * image->width / image->height;
+            float32 centreX = columns * 0.5f * (1.0f + across / depth);
+
+            out.image = image;
+            out.depth = depth;
+            out.left = centreX - screenWidth * 0.5f;
+            out.top = height * 0.5f + rowsPerCell * 0.5f / depth - screenHeight;
+            out.texelsPerColumn = image->width / screenWidth;
+            out.texelsPerRow = image->height / screenHeight;
+
+            // pixels whose centres fall inside the sprite
+            out.x0 = std::max(static_cast<int>(std::ceil(out.left - 0.5f)), area.x0);
+            out.x1 = std::min(static_cast<int>(std::ceil(out.left + screenWidth - 0.5f)) - 1, area.x1);
+            out.y0 = std::max(static_cast<int>(std::ceil(out.top - 0.5f)), area.y0);
+            out.y1 = std::min(static_cast<int>(std::ceil(out.top + screenHeight - 0.5f)) - 1, area.y1);
+            if (out.x0 > out.x1 || out.y0 > out.y1)
+            {
+                return false;
+            }
+
+            for (int tile = out.x0 / kTileColumns; tile <= out.x1 / kTileColumns; ++tile)
+            {
+                if (g_billboard.tileDepth[tile] > depth)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void draw_span(const Projected& sprite, int x0, int x1, const raycast::Hits& hits, uint8* pixels, int stride)
+        {
+            const gfx::ByteImage& image = *sprite.image;
+            for (int x = x0; x <= x1; ++x)
+            {
+                if (hits.distance[x] <= sprite.depth)
+                {
+                    continue;
+                }
+
+                int u = std::clamp(static_cast<int>((x + 0.5f - sprite.left) * sprite.texelsPerColumn), 0, image.width - 1);
+                const uint8* texels = image.data.data() + u;
+                uint8* dest = pixels + x;
+
+                float32 v = (sprite.y0 + 0.5f - sprite.top) * sprite.texelsPerRow;
+                for (int y = sprite.y0; y <= sprite.y1; ++y, v += sprite.texelsPerRow)
+                {
+                    uint8 texel = texels[std::min(static_cast<int>(v), image.height - 1) * image.width];
+                    if (texel != gfx::kTransparent)
+                    {
+                        dest[y * stride] = texel;
+                    }
+                }
+            }
+        }
+
+        int draw(const Sprites& sprites, const Camera& camera, const raycast::Hits& hits)
+        {
+            int count = sprites::get_count(sprites);
+            int columns = static_cast<int>(hits.distance.size());
+            if (count == 0 || columns == 0)
+            {
+                return 0;
+            }
+
+            int width, height;
+            gfx::query_screen_dimensions(width, height);
+
+            math::Rect<int> area = { 0, 0, std::min(columns, width) - 1, height - 1 };
+            uint8* pixels;
+            int stride;
+            if (!gfx::try_begin_shade(area, pixels, stride))
+            {
+                return 0;
+            }
+
+            float32 det = camera.planeX * camera.dirY - camera.dirX * camera.planeY;
+            float32 planeLength = std::sqrt(camera.planeX * camera.planeX + camera.planeY * camera.planeY);
+            if (det == 0 || planeLength == 0)
+            {
+                return 0;
+            }
+            float32 invDet = 1.0f / det;
+            float32 columnsPerCell = columns * 0.5f / planeLength;
+            float32 rowsPerCell = static_cast<float32>(height);
+
+            update_tile_depth(hits, columns);
+
+            g_billboard.projected.resize(count);
+            g_billboard.visible.resize(count);
+            jobs::parallel_for(0, count, kTransformGrain, [&](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    g_billboard.visible[i] = try_project(sprites, i, camera, area, invDet, columnsPerCell, rowsPerCell,
+                        columns, height, g_billboard.projected[i]);
+                }
+            });
+
+            // depths are all positive so their bits sort the same way the floats do
+            g_billboard.keys.resize(count);
+            g_billboard.values.resize(count);
+            int visibleCount = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (g_billboard.visible[i])
+                {
+                    uint32 key;
+                    std::memcpy(&key, &g_billboard.projected[i].depth, sizeof(key));
+                    g_billboard.keys[visibleCount] = key;
+                    g_billboard.values[visibleCount] = i;
+                    ++visibleCount;
+                }
+            }
+
+            g_billboard.scratchKeys.resize(visibleCount);
+            g_billboard.scratchValues.resize(visibleCount);
+            util::radix_sort(g_billboard.keys.data(), g_billboard.values.data(),
+                g_billboard.scratchKeys.data(), g_billboard.scratchValues.data(), visibleCount);
+
+            // each band owns its columns so far to near within it is all the ordering needed
+            jobs::parallel_for(area.x0, area.x1 + 1, kColumnBand, [&](int begin, int end)
+            {
+                for (int i = visibleCount - 1; i >= 0; --i)
+                {
+                    const Projected& sprite = g_billboard.projected[g_billboard.values[i]];
+                    int x0 = std::max(sprite.x0, begin);
+                    int x1 = std::min(sprite.x1, end - 1);
+                    if (x0 <= x1)
+                    {
+                        draw_span(sprite, x0, x1, hits, pixels, stride);
+                    }
+                }
+            });
+
+            return visibleCount;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+#include "tdjx_gfx.h"
+#include "raycast.h"
+
+// camera facing sprites for the raycaster. sprites get moved into camera space in batches across the job system,
+// anything behind the camera, off the sides of the screen or behind the walls in every column it covers is dropped,
+// and what's left is radix sorted on depth. drawing splits the screen into bands of columns, every band draws the
+// sprites crossing it far to near as vertical spans of texels, skipping transparent ones and any column where the
+// wall is closer than the sprite.
+
+namespace tdjx
+{
+    namespace billboard
+    {
+        // the same view that went to raycast::cast_columns
+        struct Camera
+        {
+            float32 x, y;
+            float32 dirX, dirY;
+            float32 planeX, planeY;
+        };
+
+        // every sprite stands on the floor with its image upright and facing the camera, size is how tall it is in
+        // cells (1 is as tall as a wall) and the width follows the image
+        struct Sprites
+        {
+            std::vector<float32> x;
+            std::vector<float32> y;
+            std::vector<float32> size;
+            std::vector<gfx::ImageHandle> image;
+        };
+
+        namespace sprites
+        {
+            int add(Sprites& self, float32 x, float32 y, float32 size, gfx::ImageHandle image);
+            void clear(Sprites& self);
+            int get_count(const Sprites& self);
+        }
+
+        // draws over the walls already on the active canvas, hits is the per column depth from the same camera.
+        // returns how many sprites made it past culling
+        int draw(const Sprites& sprites, const Camera& camera, const raycast::Hits& hits);
+    }
+}
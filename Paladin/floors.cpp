@@ -0,0 +1,208 @@
+#include "floors.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "tdjx_simd.h"
+#include "util.h"
+
+namespace tdjx
+{
+    namespace floors
+    {
+        const int kFixedShift = 16;
+
+        // a 4 byte gather at the last texel reads 3 past it
+        const int kGatherPadding = 3;
+
+        bool try_create(Floors& out, gfx::ImageHandle sheet, int tileSize, int floorTile, int ceilingTile,
+            int shadeLevels, float32 shadeDistance)
+        {
+            const gfx::ByteImage* image = gfx::get_image(sheet);
+            if (!image || !util::is_pow2(tileSize) || tileSize > (1 << kFixedShift) ||
+                image->width < tileSize || image->height < tileSize)
+            {
+                printf("Floor sheet doesn't hold a single %dx%d tile (tiles need to be a power of two).\n", tileSize, tileSize);
+                return false;
+            }
+
+            int tilesPerRow = image->width / tileSize;
+            int tileCount = tilesPerRow * (image->height / tileSize);
+            int levels = std::max(1, shadeLevels);
+            std::vector<uint8> shades = gfx::create_shade_table(levels);
+
+            auto copy_tile = [&](int tile, std::vector<uint8>& texels)
+            {
+                tile = std::clamp(tile, 0, tileCount - 1);
+                int tileX = (tile % tilesPerRow) * tileSize;
+                int tileY = (tile / tilesPerRow) * tileSize;
+
+                texels.assign(levels * tileSize * tileSize + kGatherPadding, 0);
+                uint8* texel = texels.data();
+                for (int level = 0; level < levels; ++level)
+                {
+                    const uint8* shade = shades.data() + level * 256;
+                    for (int v = 0; v < tileSize; ++v)
+                    {
+                        const uint8* source = image->data.data() + tileX + (tileY + v) * image->width;
+                        for (int u = 0; u < tileSize; ++u)
+                        {
+                            *texel++ = shade[source[u]];
+                        }
+                    }
+                }
+            };
+
+            out = Floors();
+            copy_tile(floorTile, out.floor);
+            copy_tile(ceilingTile, out.ceiling);
+            out.tileSize = tileSize;
+            while ((1 << out.tileShift) < tileSize)
+            {
+                ++out.tileShift;
+            }
+            out.shadeLevels = levels;
+            out.shadeDistance = shadeDistance;
+            return true;
+        }
+
+        // what stays the same across a row
+        struct Row
+        {
+            // the tile at this row's shade level
+            const uint8* texels;
+            // the wall span edge that bounds this row, ceilings stop above top and floors start at bottom
+            const int* limit;
+            bool ceiling;
+            uint32 stepU, stepV;
+            int shift;
+        };
+
+        // fixed point with everything past the texture wrapping harmlessly
+        uint32 to_fixed(float64 value)
+        {
+            return static_cast<uint32>(static_cast<int64>(std::floor(value * (1 << kFixedShift))));
+        }
+
+        bool is_open(const Row& row, int x, int y)
+        {
+            return row.ceiling ? y < row.limit[x] : y >= row.limit[x];
+        }
+
+        void cast_span(const Row& row, uint32& u, uint32& v, int y, uint8* pixels, int x, int end)
+        {
+            int coordShift = kFixedShift - row.shift;
+            uint32 mask = (1u << row.shift) - 1;
+            for (; x < end; ++x)
+            {
+                if (is_open(row, x, y))
+                {
+                    uint32 index = (((v >> coordShift) & mask) << row.shift) | ((u >> coordShift) & mask);
+                    pixels[x] = row.texels[index];
+                }
+                u += row.stepU;
+                v += row.stepV;
+            }
+        }
+
+        // eight pixels at a time, the same integer steps as cast_span so both paths come out identical
+        TDJX_TARGET_AVX2
+        static int cast_span_avx2(const Row& row, uint32& u, uint32& v, int y, uint8* pixels, int x, int end)
+        {
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i byteMask = _mm256_set1_epi32(0xff);
+            const __m256i mask = _mm256_set1_epi32((1 << row.shift) - 1);
+            const __m128i coordShift = _mm_cvtsi32_si128(kFixedShift - row.shift);
+            const __m128i rowShift = _mm_cvtsi32_si128(row.shift);
+            const __m256i vy = _mm256_set1_epi32(y);
+            const __m256i invert = _mm256_set1_epi32(row.ceiling ? 0 : -1);
+
+            // low byte of every dword to the bottom of its half, then both halves into the low 8 bytes
+            const __m256i gatherBytes = _mm256_setr_epi8(
+                0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            const __m256i joinHalves = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+
+            __m256i vu = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(u)),
+                _mm256_mullo_epi32(lanes, _mm256_set1_epi32(static_cast<int>(row.stepU))));
+            __m256i vv = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(v)),
+                _mm256_mullo_epi32(lanes, _mm256_set1_epi32(static_cast<int>(row.stepV))));
+            const __m256i stepU = _mm256_set1_epi32(static_cast<int>(row.stepU * 8));
+            const __m256i stepV = _mm256_set1_epi32(static_cast<int>(row.stepV * 8));
+
+            const int* texels = reinterpret_cast<const int*>(row.texels);
+
+            for (; x + 8 <= end; x += 8)
+            {
+                __m256i tu = _mm256_and_si256(_mm256_srl_epi32(vu, coordShift), mask);
+                __m256i tv = _mm256_and_si256(_mm256_srl_epi32(vv, coordShift), mask);
+                __m256i index = _mm256_or_si256(_mm256_sll_epi32(tv, rowShift), tu);
+
+                __m256i color = _mm256_and_si256(_mm256_i32gather_epi32(texels, index, 1), byteMask);
+
+                // ceilings write above the span (top > y), floors everywhere else
+                __m256i limit = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row.limit + x));
+                __m256i open = _mm256_xor_si256(_mm256_cmpgt_epi32(limit, vy), invert);
+
+                __m128i colors = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(color, gatherBytes), joinHalves));
+                __m128i writes = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(open, gatherBytes), joinHalves));
+                __m128i existing = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + x));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(pixels + x), _mm_blendv_epi8(existing, colors, writes));
+
+                vu = _mm256_add_epi32(vu, stepU);
+                vv = _mm256_add_epi32(vv, stepV);
+            }
+
+            u = static_cast<uint32>(_mm256_cvtsi256_si32(vu));
+            v = static_cast<uint32>(_mm256_cvtsi256_si32(vv));
+            return x;
+        }
+
+        void draw(const Floors& self, float32 x, float32 y, float32 dirX, float32 dirY, float32 planeX, float32 planeY,
+            const int* top, const int* bottom)
+        {
+            if (self.tileSize == 0)
+            {
+                return;
+            }
+
+            int width, height;
+            gfx::query_screen_dimensions(width, height);
+
+            bool useAvx2 = util::cpu_has_avx2();
+
+            gfx::shade(math::Rect<int>{ 0, 0, width - 1, height - 1 }, [&](uint8* pixels, int x0, int x1, int row)
+            {
+                // rows above the middle see the ceiling, the same distance away as the floor row mirroring them. the
+                // camera sits half a cell up, where a cell tall wall at distance d reaches height / (2 * d) rows down
+                float32 offset = row + 0.5f - height * 0.5f;
+                bool ceiling = offset < 0;
+                float32 distance = height * 0.5f / std::max(std::abs(offset), 0.5f);
+
+                float32 c = static_cast<float32>(2 * x0 + 1) / width - 1.0f;
+                float64 worldX = x + distance * (dirX + planeX * c);
+                float64 worldY = y + distance * (dirY + planeY * c);
+
+                int level = std::min(static_cast<int>(distance / self.shadeDistance * self.shadeLevels), self.shadeLevels - 1);
+
+                Row state;
+                state.texels = (ceiling ? self.ceiling.data() : self.floor.data()) + (level << (2 * self.tileShift));
+                state.limit = ceiling ? top : bottom;
+                state.ceiling = ceiling;
+                state.stepU = to_fixed(distance * planeX * 2.0f / width);
+                state.stepV = to_fixed(distance * planeY * 2.0f / width);
+                state.shift = self.tileShift;
+
+                uint32 u = to_fixed(worldX);
+                uint32 v = to_fixed(worldY);
+                int column = x0;
+                if (useAvx2)
+                {
+                    column = cast_span_avx2(state, u, v, row, pixels, column, x1 + 1);
+                }
+                cast_span(state, u, v, row, pixels, column, x1 + 1);
+            });
+        }
+    }
+}
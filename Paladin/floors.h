@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+#include "tdjx_gfx.h"
+
+// textured floor and ceiling for the raycaster, cast a row at a time. every floor row is one distance from the
+// camera, so the world position of its first pixel, the step from one pixel to the next and the shade all get worked
+// out once per row. across the row it's 16.16 fixed point adds and masks into the texture, eight pixels at a time
+// with avx2. rows are spread across the job system with gfx::shade and only pixels outside the wall spans are
+// written, so it goes on after the walls.
+
+namespace tdjx
+{
+    namespace floors
+    {
+        struct Floors
+        {
+            // one tile each for floor and ceiling, row-major, tileSize is a power of two so coordinates wrap with a mask.
+            // every shade level gets its own copy run through the palette shade table (see gfx::create_shade_table)
+            // up front, so a row picks its level once and every pixel is a single lookup
+            std::vector<uint8> floor;
+            std::vector<uint8> ceiling;
+            int tileSize = 0;
+            int tileShift = 0;
+
+            // darkest this far away
+            int shadeLevels = 0;
+            float32 shadeDistance = 0;
+        };
+
+        // tiles are numbered left to right, top to bottom across the sheet
+        bool try_create(Floors& out, gfx::ImageHandle sheet, int tileSize, int floorTile, int ceilingTile,
+            int shadeLevels, float32 shadeDistance);
+
+        // the same view the walls were cast with, top and bottom are each column's wall span [top, bottom) on the
+        // active canvas (see walls::Walls)
+        void draw(const Floors& self, float32 x, float32 y, float32 dirX, float32 dirY, float32 planeX, float32 planeY,
+            const int* top, const int* bottom);
+    }
+}
@@ -2,33 +2,48 @@
 
 #include "tdjx_gfx.h"
 #include "perlin.h"
+#include "mandelbrot.h"
+#include "mandelbrot_deep.h"
+#include "noise.h"
+#include "tdjx_progressive.h"
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 using tdjx::math::Rect;
 
 perlin_gen gen(0);
+tdjx::noise::Simplex g_simplex;
+SDL_Window* g_window = nullptr;
 int width, height, paletteSize;
 float32 aspectRatio;
-tdjx::gfx::Canvas mandelbrot_canvas;
 
 std::optional<Rect<int>> g_select;
 
+tdjx::gfx::Interlace g_interlace;
+LabExperiment g_lastExperiment = LabExperiment::Count;
+
 LabGame::LabGame(SDL_Window* window)
 {
     gen = perlin_gen(SDL_GetTicks());
+    tdjx::noise::seed(g_simplex, SDL_GetTicks());
+    g_window = window;
 
     tdjx::gfx::init_with_window(320, 160, window);
     //tdjx::gfx::load_palette("assets/palettes/win16_16.png");
     tdjx::gfx::load_palette("assets/palettes/palette_64_00.png");
     //tdjx::gfx::load_palette("assets/palettes/arne32.png");
 
+    // dynamic resolution can take it anywhere from half to double
+    tdjx::gfx::set_resolution_bounds(160, 80, 640, 320);
+
     tdjx::gfx::query_screen_dimensions(width, height);
     tdjx::gfx::query_palette_size(paletteSize);
     aspectRatio = static_cast<float32>(width) / height;
 
-    mandelbrot_canvas = tdjx::gfx::canvas::create_blank_from_screen();
-
     g_select.reset();
 }
 
@@ -43,18 +58,109 @@ void LabGame::update()
 }
 
 void render_perlin(const tdjx::GameTime& time, float32 scale, float32 colorScale, int baseColor);
-bool try_mandelbrot_iterations(float32 real, float32 imaginary, int max, int& iterations);
+void render_mandelbrot(const tdjx::mandelbrot::DeepView& view, int maxIterations);
+void render_mandelbrot_progressive(const tdjx::mandelbrot::DeepView& view, int maxIterations, float64 budgetMs);
+void render_noise(float32 scale, int octaves, float32 colorScale, int baseColor, float64 budgetMs);
+
+tdjx::mandelbrot::DeepView make_default_view()
+{
+    tdjx::mandelbrot::DeepView view;
+    view.centerX = tdjx::mandelbrot::fixed::from_double(-0.5);
+    view.centerY = tdjx::mandelbrot::fixed::from_double(0.0);
+    view.radius = 1.25;
+    return view;
+}
+
+tdjx::mandelbrot::DeepView g_view = make_default_view();
+
+// iteration counts behind the last mandelbrot frame, kept so a pan only has to fill in the strips it uncovers
+struct
+{
+    std::vector<float32> counts;
+    tdjx::mandelbrot::DeepView view;
+    int maxIterations = -1;
+    int width = 0;
+    int height = 0;
+    bool valid = false;
+    // whole pixels the image has moved since counts was filled
+    int panX = 0;
+    int panY = 0;
+} g_mandelbrot;
+
+// right mouse drag pans, sub pixel movement carries over until it adds up to a whole pixel
+bool g_panning = false;
+float32 g_panRemainderX = 0, g_panRemainderY = 0;
+
+void pan_view(int dx, int dy)
+{
+    namespace fixed = tdjx::mandelbrot::fixed;
 
-void render_mandelbrot(const Rect<float32>& view);
+    float64 pixel = 2 * g_view.radius / height;
+    g_view.centerX = fixed::sub(g_view.centerX, fixed::from_double(dx * pixel));
+    g_view.centerY = fixed::sub(g_view.centerY, fixed::from_double(dy * pixel));
+    g_mandelbrot.panX += dx;
+    g_mandelbrot.panY += dy;
+}
 
-Rect<float32> g_lastView = {};
-Rect<float32> g_view = { -2, -2, 2, 2 };
+const char* get_experiment_name(LabExperiment experiment)
+{
+    switch (experiment)
+    {
+    case LabExperiment::Perlin: return "Perlin";
+    case LabExperiment::Mandelbrot: return "Mandelbrot";
+    case LabExperiment::Noise: return "Noise";
+    default: return "Unknown";
+    }
+}
+
+void LabGame::reset_view()
+{
+    g_view = make_default_view();
+    g_mandelbrot.valid = false;
+}
 
 void LabGame::render()
 {
+    // the screen can change size between frames
+    tdjx::gfx::query_screen_dimensions(width, height);
+    aspectRatio = static_cast<float32>(width) / height;
+
     tdjx::gfx::clear(0);
-    context.scale = (tdjx::math::sin(time.elapsed * 5.0f) + 1) * 16.0f + 1.0f;
-    render_perlin(time, context.scale, context.colorScalar, context.baseColor);
+
+    // carried over pixels are only any use if last frame drew the same experiment
+    if (context.experiment != g_lastExperiment)
+    {
+        tdjx::gfx::interlace::reset(g_interlace);
+        g_lastExperiment = context.experiment;
+    }
+    g_interlace.mode = context.interlace;
+    g_interlace.rejectMotion = context.rejectMotion;
+
+    switch (context.experiment)
+    {
+    case LabExperiment::Perlin:
+        context.scale = (tdjx::math::sin(time.elapsed * 5.0f) + 1) * 16.0f + 1.0f;
+        render_perlin(time, context.scale, context.colorScalar, context.baseColor);
+        break;
+
+    case LabExperiment::Mandelbrot:
+        if (context.progressive)
+        {
+            render_mandelbrot_progressive(g_view, context.maxIterations, context.frameBudgetMs);
+        }
+        else
+        {
+            render_mandelbrot(g_view, context.maxIterations);
+        }
+        break;
+
+    case LabExperiment::Noise:
+        render_noise(context.scale, context.octaves, context.colorScalar, context.baseColor, context.frameBudgetMs);
+        break;
+
+    default:
+        break;
+    }
 }
 
 void LabGame::on_mouse_down(int x, int y, int button)
@@ -65,10 +171,20 @@ void LabGame::on_mouse_down(int x, int y, int button)
             x, y, x, y
         };
     }
+    else if (button == SDL_BUTTON_RIGHT)
+    {
+        g_panning = true;
+        g_panRemainderX = g_panRemainderY = 0;
+    }
 }
 
 void LabGame::on_mouse_up(int x, int y, int button)
 {
+    if (button == SDL_BUTTON_RIGHT)
+    {
+        g_panning = false;
+    }
+
     if (button == SDL_BUTTON_LEFT)
     {
         if (g_select.has_value())
@@ -79,18 +195,36 @@ void LabGame::on_mouse_up(int x, int y, int button)
             Rect<int> selection = *g_select;
             //tdjx::math::rect::constrain_to_aspect_ratio(selection, 2.0f);
 
-            // convert selection box screen coordinates to normalized [-1..1] space
-            float32 hw = width / 2.0f, hh = height / 2.0f;
+            // convert selection box window coordinates to normalized [-1..1] space
+            int windowWidth, windowHeight;
+            SDL_GetWindowSize(g_window, &windowWidth, &windowHeight);
+            float32 hw = windowWidth / 2.0f, hh = windowHeight / 2.0f;
 
             Rect<float32> normRect = {
-                selection.x0 / hw - 1,
-                selection.y0 / hh - 1,
-                selection.x1 / hw - 1,
-                selection.y1 / hh - 1,
+                std::min(selection.x0, selection.x1) / hw - 1,
+                std::min(selection.y0, selection.y1) / hh - 1,
+                std::max(selection.x0, selection.x1) / hw - 1,
+                std::max(selection.y0, selection.y1) / hh - 1,
             };
 
             printf("%0.2f %0.2f %0.2f %0.2f\n", normRect.x0, normRect.y0, normRect.x1, normRect.y1);
 
+            // zoom the mandelbrot view into the selection, clicks without a drag are ignored
+            if (context.experiment == LabExperiment::Mandelbrot && normRect.x1 > normRect.x0 && normRect.y1 > normRect.y0)
+            {
+                namespace fixed = tdjx::mandelbrot::fixed;
+
+                // offsets are tiny next to the centre this deep, so they get added in fixed point
+                float64 ar = static_cast<float64>(width) / height;
+                float64 offsetX = (normRect.x0 + normRect.x1) / 2 * g_view.radius * ar;
+                float64 offsetY = (normRect.y0 + normRect.y1) / 2 * g_view.radius;
+                g_view.centerX = fixed::add(g_view.centerX, fixed::from_double(offsetX));
+                g_view.centerY = fixed::add(g_view.centerY, fixed::from_double(offsetY));
+                g_view.radius = std::max(g_view.radius * std::max(normRect.x1 - normRect.x0, normRect.y1 - normRect.y0) / 2,
+                    tdjx::mandelbrot::kMinRadius);
+                g_mandelbrot.valid = false;
+            }
+
             g_select.reset();
         }
     }
@@ -103,76 +237,356 @@ void LabGame::on_mouse_move(int x, int y, int dx, int dy)
         g_select->x1 = x;
         g_select->y1 = y;
     }
+
+    if (g_panning && context.experiment == LabExperiment::Mandelbrot)
+    {
+        // window pixels to screen pixels
+        int windowWidth, windowHeight;
+        SDL_GetWindowSize(g_window, &windowWidth, &windowHeight);
+        g_panRemainderX += static_cast<float32>(dx) * width / windowWidth;
+        g_panRemainderY += static_cast<float32>(dy) * height / windowHeight;
+
+        int moveX = static_cast<int>(g_panRemainderX);
+        int moveY = static_cast<int>(g_panRemainderY);
+        if (moveX != 0 || moveY != 0)
+        {
+            g_panRemainderX -= moveX;
+            g_panRemainderY -= moveY;
+            pan_view(moveX, moveY);
+        }
+    }
 }
 
 void render_perlin(const tdjx::GameTime& time, float32 scale, float32 colorScale, int baseColor)
 {
     float32 ar = static_cast<float32>(width) / height;
+    float32 z = time.elapsed / 8.0f;
 
-    for (int y = 0; y < height; ++y)
+    float32 dx = scale * ar / width;
+    float32 dy = scale / height;
+
+    if (g_interlace.mode != tdjx::gfx::InterlaceMode::Off)
     {
-        for (int x = 0; x < width; ++x)
+        // only this frame's share of the pixels, a run of them per row
+        tdjx::gfx::shade_interlaced(g_interlace, Rect<int>{ 0, 0, width - 1, height - 1 }, [&](int y, int x0, int xStep, int count, uint8* out)
         {
-            float32 nx = static_cast<float32>(x) / width * scale * ar - scale;
-            float32 ny = static_cast<float32>(y) / height * scale - scale / 2 ;
+            gen.fill_grid(-scale + x0 * dx, -scale / 2 + y * dy, dx * xStep, dy, count, 1, z,
+                colorScale, baseColor, paletteSize - 1, out, count);
+        });
+        return;
+    }
+
+    Rect<int> area{ 0, 0, width - 1, height - 1 };
+    uint8* pixels;
+    int stride;
+    if (!tdjx::gfx::try_begin_shade(area, pixels, stride))
+    {
+        return;
+    }
+
+    // regular grid straight into the canvas, each band of rows walks the noise lattice a cell at a time
+    tdjx::gfx::parallel_rows(area.y0, area.y1, [&](int y0, int y1)
+    {
+        gen.fill_grid(-scale + area.x0 * dx, -scale / 2 + y0 * dy, dx, dy, area.x1 - area.x0 + 1, y1 - y0 + 1, z,
+            colorScale, baseColor, paletteSize - 1, pixels + y0 * stride + area.x0, stride);
+    });
+}
 
-            float32 z = time.elapsed / 8.0f;
-            float32 v = gen.noise(nx, ny, z);
+// 4x4 ordered dither thresholds, spreads the fractional part of the smooth count between two palette entries
+const float32 kDitherThresholds[4][4] = {
+    { 0.5f / 16, 8.5f / 16, 2.5f / 16, 10.5f / 16 },
+    { 12.5f / 16, 4.5f / 16, 14.5f / 16, 6.5f / 16 },
+    { 3.5f / 16, 11.5f / 16, 1.5f / 16, 9.5f / 16 },
+    { 15.5f / 16, 7.5f / 16, 13.5f / 16, 5.5f / 16 },
+};
 
-            int iv = static_cast<int>(v * colorScale);
+const int kMandelbrotBaseColor = 24;
+const int kMandelbrotColorCount = 12;
 
-            tdjx::gfx::point(x, y, iv + baseColor);
-        }
+uint8 get_mandelbrot_color(float32 mu, int x, int y)
+{
+    if (mu == tdjx::mandelbrot::kInterior)
+    {
+        return 0;
+    }
+
+    int n = static_cast<int>(mu);
+    if (mu - n > kDitherThresholds[y & 3][x & 3])
+    {
+        ++n;
+    }
+    return static_cast<uint8>(kMandelbrotBaseColor + n % kMandelbrotColorCount);
+}
+
+void write_mandelbrot_row(uint8* row, int x0, int x1, int y, const float32* counts)
+{
+    for (int x = x0; x <= x1; ++x)
+    {
+        row[x] = get_mandelbrot_color(counts[x - x0], x, y);
     }
 }
 
-bool try_mandelbrot_iterations(float32 real, float32 imaginary, int max, int& iterations)
+// the reference orbit only depends on the centre and iteration count so it's kept until either changes
+struct
 {
-    struct complex { float32 r, i; };
-    complex c = { real, imaginary };
+    tdjx::mandelbrot::ReferenceOrbit orbit;
+    tdjx::mandelbrot::DeepView view;
+    int maxIterations = -1;
+} g_reference;
 
-    auto magSqr = [](const complex& c)
+bool same_center(const tdjx::mandelbrot::DeepView& a, const tdjx::mandelbrot::DeepView& b)
+{
+    // limb by limb, Fixed has padding after negative that memcmp would read
+    auto same = [](const tdjx::mandelbrot::Fixed& x, const tdjx::mandelbrot::Fixed& y)
     {
-        return c.r * c.r + c.i * c.i;
+        return x.negative == y.negative && std::equal(std::begin(x.limbs), std::end(x.limbs), std::begin(y.limbs));
     };
+    return same(a.centerX, b.centerX) && same(a.centerY, b.centerY);
+}
 
-    for (int i = 0; i < max; ++i)
-    {
-        float32 tempReal = c.r;
-        c.r = (c.r * c.r) - (c.i * c.i);
-        c.i *= 2 * tempReal;
-        c.r += real;
-        c.i += imaginary;
+// everything it takes to sample one frame of the view, float, double or perturbation depending on how deep it is
+struct MandelbrotFrame
+{
+    float64 pixel;
+    // view centre plus the offset to the top left pixel centre, and that offset on its own for perturbation
+    float64 x0, y0;
+    float64 left, top;
+    bool useDeep;
+    bool useDouble;
+    int maxIterations;
+};
+
+MandelbrotFrame prepare_mandelbrot(const tdjx::mandelbrot::DeepView& view, int maxIterations)
+{
+    namespace mandelbrot = tdjx::mandelbrot;
 
-        if (magSqr(c) >= 16)
-        {
-            iterations = i;
-            return true;
-        }
+    MandelbrotFrame frame;
+    frame.pixel = 2 * view.radius / height;
+    frame.maxIterations = maxIterations;
+
+    float64 cx = mandelbrot::fixed::to_double(view.centerX);
+    float64 cy = mandelbrot::fixed::to_double(view.centerY);
+
+    // left/top edge offsets from the centre, sampling at pixel centres
+    frame.left = (0.5 - width / 2.0) * frame.pixel;
+    frame.top = (0.5 - height / 2.0) * frame.pixel;
+    frame.x0 = cx + frame.left;
+    frame.y0 = cy + frame.top;
+
+    float64 magnitude = std::max({ 1.0, std::abs(cx) + std::abs(frame.left), std::abs(cy) + std::abs(frame.top) });
+    frame.useDeep = frame.pixel < mandelbrot::kDoublePrecisionLimit * magnitude;
+    // float is twice as wide and plenty until a pixel gets too small next to the coordinates it's at
+    frame.useDouble = frame.pixel < mandelbrot::kFloatPrecisionLimit * magnitude;
+
+    if (frame.useDeep && (g_reference.maxIterations != maxIterations || g_reference.view.radius != view.radius || !same_center(g_reference.view, view)))
+    {
+        float64 seriesRadius = std::hypot(frame.left, frame.top);
+        mandelbrot::build_reference(view, maxIterations, seriesRadius, g_reference.orbit);
+        g_reference.view = view;
+        g_reference.maxIterations = maxIterations;
     }
 
-    return false;
+    return frame;
 }
 
-void render_mandelbrot(const Rect<float32>& view)
+// count pixels on row y starting at x, xStep pixels apart
+void sample_mandelbrot(const MandelbrotFrame& frame, int x, int y, int xStep, int count, float32* out)
 {
-    float32 ar = static_cast<float32>(width) / height;
+    namespace mandelbrot = tdjx::mandelbrot;
+
+    float64 step = xStep * frame.pixel;
+    if (frame.useDeep)
+    {
+        mandelbrot::iterate_row_perturbed(g_reference.orbit, frame.left + x * frame.pixel, step, frame.top + y * frame.pixel,
+            count, frame.maxIterations, out);
+    }
+    else if (frame.useDouble)
+    {
+        mandelbrot::iterate_row(frame.x0 + x * frame.pixel, step, frame.y0 + y * frame.pixel, count, frame.maxIterations, out);
+    }
+    else
+    {
+        mandelbrot::iterate_row(static_cast<float32>(frame.x0 + x * frame.pixel), static_cast<float32>(step),
+            static_cast<float32>(frame.y0 + y * frame.pixel), count, frame.maxIterations, out);
+    }
+}
+
+// square tiles each get their own subdivision pass, small enough to spread across threads
+const int kMandelbrotTileSize = 32;
+
+void render_mandelbrot(const tdjx::mandelbrot::DeepView& view, int maxIterations)
+{
+    namespace mandelbrot = tdjx::mandelbrot;
+
+    MandelbrotFrame frame = prepare_mandelbrot(view, maxIterations);
+    auto sample = [&](int x, int y, int count, float32* out)
+    {
+        sample_mandelbrot(frame, x, y, 1, count, out);
+    };
+
+    std::vector<float32>& counts = g_mandelbrot.counts;
+    std::vector<Rect<int>> dirty;
 
-    float32 x0, y0, x1, y1;
-    tdjx::math::rect::unpack(view, x0, y0, x1, y1);
+    int panX = g_mandelbrot.panX, panY = g_mandelbrot.panY;
+    bool reuse = g_mandelbrot.valid && g_mandelbrot.maxIterations == maxIterations && g_mandelbrot.view.radius == view.radius &&
+        g_mandelbrot.width == width && g_mandelbrot.height == height && std::abs(panX) < width && std::abs(panY) < height;
 
-    for (int y = 0; y < height; ++y)
+    if (!reuse)
     {
-        float32 my = tdjx::math::lerp(y0, y1, static_cast<float32>(y) / height);
-        for (int x = 0; x < width; ++x)
+        counts.resize(width * height);
+        dirty.push_back({ 0, 0, width - 1, height - 1 });
+    }
+    else if (panX != 0 || panY != 0)
+    {
+        // slide what's still on screen over, then the strips that were uncovered get computed
+        static std::vector<float32> s_shifted;
+        s_shifted.assign(counts.size(), mandelbrot::kInterior);
+        for (int y = std::max(0, panY); y < std::min(height, height + panY); ++y)
         {
-            float32 mx = tdjx::math::lerp(x0, x1, static_cast<float32>(x) / width) * ar;
+            const float32* src = counts.data() + (y - panY) * width;
+            float32* dest = s_shifted.data() + y * width;
+            int xStart = std::max(0, panX), xEnd = std::min(width, width + panX);
+            std::copy(src + xStart - panX, src + xEnd - panX, dest + xStart);
+        }
+        counts.swap(s_shifted);
+
+        // the column strip takes the corner on a diagonal pan, tiles get filled in parallel so none can overlap
+        int stripX0 = panX > 0 ? panX : 0;
+        int stripX1 = panX < 0 ? width + panX - 1 : width - 1;
+        if (panX > 0) dirty.push_back({ 0, 0, panX - 1, height - 1 });
+        if (panX < 0) dirty.push_back({ width + panX, 0, width - 1, height - 1 });
+        if (panY > 0) dirty.push_back({ stripX0, 0, stripX1, panY - 1 });
+        if (panY < 0) dirty.push_back({ stripX0, height + panY, stripX1, height - 1 });
+    }
 
-            int iterations;
-            if (try_mandelbrot_iterations(mx, my, 200, iterations))
+    std::vector<Rect<int>> tiles;
+    for (const Rect<int>& r : dirty)
+    {
+        for (int ty = r.y0; ty <= r.y1; ty += kMandelbrotTileSize)
+        {
+            for (int tx = r.x0; tx <= r.x1; tx += kMandelbrotTileSize)
             {
-                tdjx::gfx::point(x, y, iterations % 12 + 24);
+                tiles.push_back({ tx, ty, std::min(tx + kMandelbrotTileSize - 1, r.x1), std::min(ty + kMandelbrotTileSize - 1, r.y1) });
             }
         }
     }
-}
\ No newline at end of file
+
+    tdjx::jobs::parallel_for(0, static_cast<int>(tiles.size()), 1, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            const Rect<int>& tile = tiles[i];
+            mandelbrot::subdivide(tile.x0, tile.y0, tile.x1, tile.y1, counts.data(), width, sample);
+        }
+    });
+
+    g_mandelbrot.view = view;
+    g_mandelbrot.maxIterations = maxIterations;
+    g_mandelbrot.width = width;
+    g_mandelbrot.height = height;
+    g_mandelbrot.valid = true;
+    g_mandelbrot.panX = g_mandelbrot.panY = 0;
+
+    tdjx::gfx::shade(Rect<int>{ 0, 0, width - 1, height - 1 }, [&](uint8* row, int rx0, int rx1, int y)
+    {
+        write_mandelbrot_row(row, rx0, rx1, y, counts.data() + y * width + rx0);
+    });
+}
+
+// what g_progressive was last started on, any change starts it over
+struct
+{
+    LabExperiment experiment = LabExperiment::Count;
+    tdjx::mandelbrot::DeepView view;
+    int maxIterations = -1;
+    float32 scale = 0;
+    int octaves = 0;
+    int baseColor = 0;
+    float32 colorScalar = 0;
+} g_progressiveSource;
+
+tdjx::progressive::Image g_progressive;
+
+void render_mandelbrot_progressive(const tdjx::mandelbrot::DeepView& view, int maxIterations, float64 budgetMs)
+{
+    if (g_progressiveSource.experiment != LabExperiment::Mandelbrot || g_progressive.width != width || g_progressive.height != height ||
+        g_progressiveSource.maxIterations != maxIterations ||
+        g_progressiveSource.view.radius != view.radius || !same_center(g_progressiveSource.view, view))
+    {
+        tdjx::progressive::restart(g_progressive, width, height);
+        g_progressiveSource.experiment = LabExperiment::Mandelbrot;
+        g_progressiveSource.view = view;
+        g_progressiveSource.maxIterations = maxIterations;
+    }
+
+    if (!tdjx::progressive::is_finished(g_progressive))
+    {
+        MandelbrotFrame frame = prepare_mandelbrot(view, maxIterations);
+        tdjx::progressive::refine(g_progressive, budgetMs, [&](int y, int x0, int xStep, int count, uint8* out)
+        {
+            static thread_local std::vector<float32> t_counts;
+            t_counts.resize(count);
+            sample_mandelbrot(frame, x0, y, xStep, count, t_counts.data());
+            for (int i = 0; i < count; ++i)
+            {
+                out[i] = get_mandelbrot_color(t_counts[i], x0 + i * xStep, y);
+            }
+        });
+    }
+
+    tdjx::progressive::present(g_progressive);
+}
+
+void render_noise(float32 scale, int octaves, float32 colorScale, int baseColor, float64 budgetMs)
+{
+    if (g_progressiveSource.experiment != LabExperiment::Noise || g_progressive.width != width || g_progressive.height != height ||
+        g_progressiveSource.scale != scale || g_progressiveSource.octaves != octaves ||
+        g_progressiveSource.colorScalar != colorScale || g_progressiveSource.baseColor != baseColor)
+    {
+        tdjx::progressive::restart(g_progressive, width, height);
+        g_progressiveSource.experiment = LabExperiment::Noise;
+        g_progressiveSource.scale = scale;
+        g_progressiveSource.octaves = octaves;
+        g_progressiveSource.colorScalar = colorScale;
+        g_progressiveSource.baseColor = baseColor;
+    }
+
+    tdjx::noise::Fractal fractal;
+    fractal.octaves = std::max(1, octaves);
+
+    // scale is the height of the view in noise units, centred on the origin
+    float32 unit = scale / height;
+    float32 left = -0.5f * width * unit;
+    float32 top = -0.5f * height * unit;
+
+    tdjx::progressive::refine(g_progressive, budgetMs, [&](int y, int x0, int xStep, int count, uint8* out)
+    {
+        static thread_local std::vector<float32> t_xs, t_ys, t_values;
+        t_xs.resize(count);
+        t_ys.assign(count, top + y * unit);
+        t_values.resize(count);
+        for (int i = 0; i < count; ++i)
+        {
+            t_xs[i] = left + (x0 + i * xStep) * unit;
+        }
+
+        tdjx::noise::fbm2_batch(g_simplex, fractal, t_xs.data(), t_ys.data(), t_values.data(), count);
+        for (int i = 0; i < count; ++i)
+        {
+            float32 value = t_values[i] * 0.5f + 0.5f;
+            out[i] = static_cast<uint8>((static_cast<int>(value * colorScale) + baseColor) & (paletteSize - 1));
+        }
+    });
+
+    tdjx::progressive::present(g_progressive);
+}
+
+bool LabGame::is_progressive() const
+{
+    return context.experiment == LabExperiment::Noise || (context.experiment == LabExperiment::Mandelbrot && context.progressive);
+}
+
+float32 LabGame::get_progress() const
+{
+    return is_progressive() ? tdjx::progressive::get_progress(g_progressive) : 1.0f;
+}
@@ -9,11 +9,33 @@
 
 struct SDL_Window;
 
+enum class LabExperiment
+{
+    Perlin,
+    Mandelbrot,
+    Noise,
+    Count,
+};
+
+const char* get_experiment_name(LabExperiment experiment);
+
 struct LabContext
 {
+    LabExperiment experiment = LabExperiment::Perlin;
     int baseColor = 0;
     float32 colorScalar = 32.0f;
     float32 scale = 8.0f;
+    int maxIterations = 200;
+    int octaves = 8;
+
+    // mandelbrot refines over several frames instead of finishing every frame
+    bool progressive = false;
+    // time each frame gets for progressive renders
+    float32 frameBudgetMs = 8.0f;
+
+    // perlin only evaluates part of the screen each frame and reuses the rest
+    tdjx::gfx::InterlaceMode interlace = tdjx::gfx::InterlaceMode::Off;
+    bool rejectMotion = true;
 };
 
 struct LabGame : public tdjx::Game<LabContext>
@@ -27,4 +49,12 @@ struct LabGame : public tdjx::Game<LabContext>
     void on_mouse_down(int x, int y, int button) override;
     void on_mouse_up(int x, int y, int button) override;
     void on_mouse_move(int x, int y, int dx, int dy) override;
+
+    void reset_view();
+
+    // progressive experiments spend their frame budget whatever the resolution
+    bool is_progressive() const;
+
+    // 0..1, how far the current progressive render has got
+    float32 get_progress() const;
 };
\ No newline at end of file
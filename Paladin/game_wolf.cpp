@@ -2,36 +2,125 @@
 
 #include <SDL2/SDL.h>
 #include <algorithm>
+#include <random>
 #include "tdjx_gfx.h"
-#include "renderer.h"
-
-struct Room
+#include "raycast.h"
+#include "billboard.h"
+#include "walls.h"
+#include "floors.h"
+
+const int kRoomWidth = 8;
+const int kRoomHeight = 8;
+// digits pick the wall texture
+const char* kTestRoom =
+    "00000000"
+    "0      1"
+    "0      1"
+    "0   3  1"
+    "0      1"
+    "0      1"
+    "0      1"
+    "22222222";
+
+// open ground with scattered pillars, big enough that walking the grid a cell at a time would crawl
+const int kFieldSize = 2048;
+const float32 kFieldPillarChance = 0.002f;
+
+// trees scattered around where the player lands in the field
+const int kFieldTreeCount = 4096;
+const int kFieldTreeSpread = 256;
+
+// the overhead map only fits rooms this small
+const int kMinimapMaxSize = 32;
+
+tdjx::raycast::Grid g_room;
+tdjx::raycast::Grid g_field;
+tdjx::raycast::Hits g_hits;
+tdjx::billboard::Sprites g_roomSprites;
+tdjx::billboard::Sprites g_fieldSprites;
+tdjx::gfx::ImageHandle g_treeImage = tdjx::gfx::kInvalidHandle;
+bool g_inField = false;
+
+// walls go down a column at a time into g_columns and get transposed onto the screen, instead of a row at a time
+// straight onto it
+bool g_columnMajor = true;
+tdjx::gfx::Canvas g_columns;
+
+tdjx::walls::Walls g_wallTextures;
+const int kWallTileSize = 32;
+const int kWallShadeLevels = 8;
+const float32 kWallShadeDistance = 16.0f;
+
+// floor and ceiling come off the same sheet
+tdjx::floors::Floors g_floors;
+const int kFloorTile = 1;
+const int kCeilingTile = 2;
+
+void create_field()
 {
-    int w, h;
-    const char* data;
-};
-
-Room testRoom = {
-    8, 8,
-    "********"
-    "*      *"
-    "*      *"
-    "*      *"
-    "*      *"
-    "*      *"
-    "*      *"
-    "********"
-};
-
-bool cast_ray(const Room& room, float32 ox, float32 oy, float32 rot, float32& distOut);
-
-WolfGame::WolfGame(SDL_Window* window)
+    g_field = tdjx::raycast::grid::create(kFieldSize, kFieldSize);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float32> chance(0.0f, 1.0f);
+    for (int y = 0; y < kFieldSize; ++y)
+    {
+        for (int x = 0; x < kFieldSize; ++x)
+        {
+            bool edge = x == 0 || y == 0 || x == kFieldSize - 1 || y == kFieldSize - 1;
+            if (edge || chance(rng) < kFieldPillarChance)
+            {
+                tdjx::raycast::grid::set_cell(g_field, x, y, edge ? '0' : '1');
+            }
+        }
+    }
+
+    // keep the spot the player lands on clear
+    int centre = kFieldSize / 2;
+    for (int y = centre - 2; y <= centre + 2; ++y)
+    {
+        for (int x = centre - 2; x <= centre + 2; ++x)
+        {
+            tdjx::raycast::grid::set_cell(g_field, x, y, 0);
+        }
+    }
+
+    tdjx::raycast::grid::update_distance(g_field);
+
+    tdjx::billboard::sprites::clear(g_fieldSprites);
+    std::uniform_real_distribution<float32> offset(-kFieldTreeSpread * 0.5f, kFieldTreeSpread * 0.5f);
+    std::uniform_real_distribution<float32> size(0.5f, 1.5f);
+    for (int i = 0; i < kFieldTreeCount; ++i)
+    {
+        float32 x = centre + offset(rng);
+        float32 y = centre + offset(rng);
+        if (tdjx::raycast::grid::get_cell(g_field, static_cast<int>(x), static_cast<int>(y)) == 0)
+        {
+            tdjx::billboard::sprites::add(g_fieldSprites, x, y, size(rng), g_treeImage);
+        }
+    }
+}
+
+WolfGame::WolfGame(SDL_Window* window, const char* mapFile)
 {
     const int k_width = 320;
     const int k_height = 240;
 
     context.window = window;
     tdjx::gfx::init_with_window(k_width, k_height, window);
+
+    // maps are looked up against the palette so they can only load once gfx is up
+    if (!mapFile || !tdjx::raycast::grid::try_load_from_image(mapFile, g_room))
+    {
+        g_room = tdjx::raycast::grid::create_from_string(kTestRoom, kRoomWidth, kRoomHeight);
+    }
+
+    tdjx::gfx::ImageHandle wallSheet = tdjx::gfx::load_image("assets/walls.png");
+    tdjx::walls::try_create(g_wallTextures, wallSheet, kWallTileSize, kWallShadeLevels, kWallShadeDistance);
+    tdjx::floors::try_create(g_floors, wallSheet, kWallTileSize, kFloorTile, kCeilingTile, kWallShadeLevels, kWallShadeDistance);
+
+    g_treeImage = tdjx::gfx::load_image("assets/tree.png");
+    tdjx::billboard::sprites::add(g_roomSprites, 5.5f, 2.5f, 1.0f, g_treeImage);
+    tdjx::billboard::sprites::add(g_roomSprites, 5.5f, 5.5f, 0.6f, g_treeImage);
 }
 
 WolfGame::~WolfGame()
@@ -71,164 +160,155 @@ void WolfGame::update()
     }
 }
 
-void WolfGame::render()
+void WolfGame::on_key_down(int key)
 {
-    WolfContext::Player& player = context.player;
-
-    int width, height;
-    tdjx::gfx::query_screen_dimensions(width, height);
-
-    tdjx::gfx::clear(0);
-
-    Room room = testRoom;
-
-    const int size = 16;
+    if (key == SDL_SCANCODE_C)
+    {
+        g_columnMajor = !g_columnMajor;
+    }
 
+    // swap between the room and the big field, each keeps the player somewhere open
+    if (key == SDL_SCANCODE_M)
     {
-        for (int x = 0; x < width; ++x)
+        g_inField = !g_inField;
+        if (g_inField && g_field.width == 0)
         {
-            float32 dist;
-
-            float32 r = player.rot + (static_cast<float32>(x) / width)* static_cast<float32>(M_PI) / 4.f;
-
-            if (cast_ray(room, player.x, player.y, r, dist))
-            {
-                float32 yy = 8.0f / dist * height / 2;
-                //tdjx::gfx::line(x, k_height / 2 - yy, x, k_height / 2 + yy, 12);
-            }
+            create_field();
         }
-    }
 
-    for (int y = 0; y < room.h; ++y)
-    {
-        for (int x = 0; x < room.w; ++x)
+        WolfContext::Player& player = context.player;
+        if (g_inField)
         {
-            char cell = room.data[x + y * room.w];
-            if (cell == '*')
-            {
-                int sx = x * size;
-                int sy = y * size;
-                tdjx::gfx::rectangle_fill(sx, sy, sx + size - 1, sy + size - 1, 21);
-            }
+            player.x = player.y = kFieldSize / 2 + 0.5f;
+        }
+        else
+        {
+            player.x = 2;
+            player.y = 4;
         }
     }
+}
 
-    auto draw_ray = [](float32 ox, float32 oy, float32 r, float32 d, int color)
-    {
-        tdjx::gfx::line(
-            static_cast<int>(ox * 16),
-            static_cast<int>(oy * 16),
-            static_cast<int>(ox * 16 + d * 16 * std::cos(r)),
-            static_cast<int>(oy * 16 + d * 16 * std::sin(r)),
-            color
-        );
-    };
-
-    {
-        float32 dist = 0.0f;
-        bool hit = cast_ray(room, player.x, player.y, player.rot, dist);
-
-        dist = (hit) ? dist : 8;
-
-        int hitX = static_cast<int>(player.x * size + std::cos(player.rot) * dist);
-        int hitY = static_cast<int>(player.y * size + std::sin(player.rot) * dist);
+// horizontal field of view, the camera plane is tan(fov / 2) long either side of the view direction
+const float32 kFieldOfView = static_cast<float32>(M_PI) / 3.0f;
 
-        tdjx::gfx::circle(hitX, hitY, 4, 28);
+// flat colours for anything the sheet didn't load for
+const int kCeilingColor = 1;
+const int kFloorColor = 5;
+const int kWallColor = 12;
+const int kWallShadedColor = 11;
 
-        draw_ray(player.x, player.y, player.rot, 8, 8);
-        draw_ray(player.x, player.y, player.rot - static_cast<float32>(M_PI) / 4.f, 8, 8);
-        draw_ray(player.x, player.y, player.rot + static_cast<float32>(M_PI) / 4.f, 8, 8);
+// covers whatever walls::draw and floors::draw left alone so nothing from the last frame shows through
+void draw_flat_fallback(int width, int height)
+{
+    bool flatFloors = g_floors.tileSize == 0;
+    bool flatWalls = g_wallTextures.tileCount == 0;
+    if (!flatFloors && !flatWalls)
+    {
+        return;
     }
 
-    tdjx::render::set_intensity(tdjx::gfx::get_pixels());
+    tdjx::gfx::shade(tdjx::math::Rect<int>{ 0, 0, width - 1, height - 1 }, [&](uint8* row, int x0, int x1, int y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            if (y < g_wallTextures.top[x])
+            {
+                if (flatFloors) row[x] = kCeilingColor;
+            }
+            else if (y >= g_wallTextures.bottom[x])
+            {
+                if (flatFloors) row[x] = kFloorColor;
+            }
+            else if (flatWalls)
+            {
+                row[x] = (g_hits.side[x] == 0) ? kWallShadedColor : kWallColor;
+            }
+        }
+    });
 }
 
-template <typename T> int sgn(T val)
+void WolfGame::render()
 {
-    return (static_cast<T>(0) < val) - (val < static_cast<T>(0));
-}
-
+    WolfContext::Player& player = context.player;
 
-bool cast_ray(const Room& room, float32 ox, float32 oy, float32 rot, float32& distOut)
-{
-    float32 dx = std::cos(rot);
-    float32 dy = std::sin(rot);
+    int width, height;
+    tdjx::gfx::query_screen_dimensions(width, height);
 
-    int cellX = static_cast<int>(ox);
-    int cellY = static_cast<int>(oy);
+    float32 dirX = std::cos(player.rot);
+    float32 dirY = std::sin(player.rot);
+    float32 planeLength = std::tan(kFieldOfView / 2);
+    float32 planeX = -dirY * planeLength;
+    float32 planeY = dirX * planeLength;
 
-    int stepX, outX, x = cellX;
-    int stepY, outY, y = cellY;
+    const tdjx::raycast::Grid& grid = g_inField ? g_field : g_room;
+    tdjx::raycast::cast_columns(grid, player.x, player.y, dirX, dirY, planeX, planeY, width, g_hits);
 
-    if (x < 0 || x >= room.w || y < 0 || y >= room.h)
+    if (g_columnMajor)
     {
-        return false;
-    }
-
-    stepX = sgn(dx);
-    stepY = sgn(dy);
-
-    float32 cbX = static_cast<float32>(x + ((dx > 0) ? 1 : 0));
-    float32 cbY = static_cast<float32>(y + ((dy > 0) ? 1 : 0));
-
-    outX = (dx > 0) ? room.w : -1;
-    outY = (dy > 0) ? room.h : -1;
-
-    float32 rxr, ryr;
-    float32 tMaxX, tMaxY;
-    float32 tDeltaX, tDeltaY;
+        // every span is contiguous in the column canvas, turned the right way up on the way to the screen
+        if (g_columns.width != height || g_columns.height != width)
+        {
+            g_columns = tdjx::gfx::canvas::create_columns_from_screen();
+        }
 
-    if (dx != 0)
-    {
-        rxr = 1.0f / dx;
-        tMaxX = cbX - ox * rxr;
-        tDeltaX = room.w * stepX * rxr;
+        tdjx::walls::draw(g_wallTextures, grid, g_hits, dirX, dirY, planeX, planeY, g_columns.data.data(), height, 1, height);
+        tdjx::gfx::draw_columns_to_screen(g_columns);
     }
     else
     {
-        tMaxX = std::numeric_limits<float32>::infinity();
+        tdjx::walls::draw(g_wallTextures, grid, g_hits, dirX, dirY, planeX, planeY, tdjx::gfx::get_pixels(), 1, width, height);
     }
 
-    if (dy != 0)
-    {
-        ryr = 1.0f / dy;
-        tMaxY = cbY - oy * rxr;
-        tDeltaY = room.h * stepY * ryr;
-    }
-    else
+    // floor and ceiling go a row at a time straight onto the screen around the wall spans
+    tdjx::floors::draw(g_floors, player.x, player.y, dirX, dirY, planeX, planeY,
+        g_wallTextures.top.data(), g_wallTextures.bottom.data());
+    draw_flat_fallback(width, height);
+
+    tdjx::billboard::Camera camera = { player.x, player.y, dirX, dirY, planeX, planeY };
+    tdjx::billboard::draw(g_inField ? g_fieldSprites : g_roomSprites, camera, g_hits);
+
+    if (grid.width > kMinimapMaxSize || grid.height > kMinimapMaxSize)
     {
-        tMaxY = std::numeric_limits<float32>::infinity();
+        return;
     }
 
-    while (true)
-    {
-        char cell = room.data[x + y * room.w];
-        if (cell == '*')
-        {
-            break;
-        }
+    // overhead map in the corner
+    const int size = 4;
 
-        if (tMaxX < tMaxY)
-        {
-            x = x + stepX;
-            if (x == outX)
-            {
-                return false;
-            }
-            tMaxX += tDeltaX;
-        }
-        else
+    for (int y = 0; y < grid.height; ++y)
+    {
+        for (int x = 0; x < grid.width; ++x)
         {
-            y = y + stepY;
-            if (y == outY)
+            if (tdjx::raycast::grid::get_cell(grid, x, y) != 0)
             {
-                return false;
+                int sx = x * size;
+                int sy = y * size;
+                tdjx::gfx::rectangle_fill(sx, sy, sx + size - 1, sy + size - 1, 21);
             }
-            tMaxY += tDeltaY;
         }
     }
 
-    distOut = std::min(tMaxX, tMaxY);
+    auto draw_ray = [size](float32 ox, float32 oy, float32 dx, float32 dy, float32 d, int color)
+    {
+        tdjx::gfx::line(
+            static_cast<int>(ox * size),
+            static_cast<int>(oy * size),
+            static_cast<int>((ox + d * dx) * size),
+            static_cast<int>((oy + d * dy) * size),
+            color
+        );
+    };
 
-    return true;
-}
\ No newline at end of file
+    if (width > 0)
+    {
+        // edges of the view and the centre, out to where each one hit
+        const int columns[] = { 0, width / 2, width - 1 };
+        for (int x : columns)
+        {
+            float32 c = static_cast<float32>(2 * x + 1) / width - 1.0f;
+            float32 distance = std::min(g_hits.distance[x], static_cast<float32>(grid.width + grid.height));
+            draw_ray(player.x, player.y, dirX + planeX * c, dirY + planeY * c, distance, 8);
+        }
+    }
+}
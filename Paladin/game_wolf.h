@@ -17,9 +17,12 @@ struct WolfContext
 
 struct WolfGame : public tdjx::Game<WolfContext>
 {
-    WolfGame(SDL_Window* window);
+    // mapFile is an indexed image for raycast::grid::try_load_from_image, the built in room if it's missing
+    WolfGame(SDL_Window* window, const char* mapFile = nullptr);
     ~WolfGame();
 
     void update() override final;
     void render() override final;
+
+    void on_key_down(int key) override;
 };
\ No newline at end of file
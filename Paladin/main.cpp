@@ -5,6 +5,7 @@
 #include <iostream>
 #include <cstdlib>
 #include <cinttypes>
+#include <cstring>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -25,6 +26,8 @@
 #include "tdjx_game.h"
 
 #include "util.h"
+#include "noise.h"
+#include "tdjx_jobs.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
@@ -45,6 +48,8 @@ int main(int argc, char* argv[])
 
     SDL_Init(SDL_INIT_VIDEO);
 
+    tdjx::jobs::init();
+
     //const int kWindowWidth = 1440;
     //const int kWindowHeight = 1080;
     const int kWindowWidth = 640;
@@ -85,6 +90,10 @@ int main(int argc, char* argv[])
     bool shouldReloadShaders = false;
     bool showImgui = false;
 
+    tdjx::gfx::DynamicResolution dynamicResolution;
+    bool useDynamicResolution = false;
+    float32 rasterMs = 0.f;
+
     auto app_quit = [&isRunning]() { isRunning = false; };
     auto app_reload_shaders = [&shouldReloadShaders]() { shouldReloadShaders = true; };
     auto toggle_imgui = [&showImgui]() { showImgui = !showImgui; };
@@ -122,7 +131,16 @@ int main(int argc, char* argv[])
         1, 5, 7
     };
 
-    std::unique_ptr<BaseGame> game(new LabGame(window));
+    // lab unless asked for something else on the command line, wolf takes an optional map image after it
+    std::unique_ptr<BaseGame> game;
+    if (argc > 1 && strcmp(argv[1], "wolf") == 0)
+    {
+        game.reset(new WolfGame(window, (argc > 2) ? argv[2] : nullptr));
+    }
+    else
+    {
+        game.reset(new LabGame(window));
+    }
 
     SDL_GL_GetDrawableSize(window, &wdw, &wdh);
 
@@ -136,6 +154,9 @@ int main(int argc, char* argv[])
             tdjx::render::reload_shaders();
         }
 
+        // anything jobs left for the gl thread
+        tdjx::jobs::pump_main();
+
         // Process Events
         SDL_Event event;
         while (SDL_PollEvent(&event))
@@ -209,10 +230,27 @@ int main(int argc, char* argv[])
             }
         }
 
+        // screen size for this frame picked off how long the last one took. progressive renders fill their budget
+        // at any size and start over on every resize, so the resolution holds while one is up
+        LabGame* progressiveLab = game->get_game_as<LabGame>();
+        if (progressiveLab && progressiveLab->is_progressive())
+        {
+            // times from here on say nothing about the next experiment, it starts over when this one ends
+            dynamicResolution.averageMs = 0.0f;
+            dynamicResolution.framesSinceResize = 0;
+        }
+        else if (useDynamicResolution)
+        {
+            tdjx::gfx::dynamic_resolution::update(dynamicResolution, rasterMs);
+        }
+
         game->time.elapsed = time;
         game->time.delta = dt;
         game->update();
+
+        uint64 renderTicks = SDL_GetPerformanceCounter();
         game->render();
+        rasterMs = static_cast<float32>(static_cast<float64>(SDL_GetPerformanceCounter() - renderTicks) * 1000.0 / frequency);
 
         // UI
         ImGui_ImplOpenGL3_NewFrame();
@@ -231,6 +269,14 @@ int main(int argc, char* argv[])
                 app_reload_shaders();
             }
 
+            {
+                int screenWidth, screenHeight;
+                tdjx::gfx::query_screen_dimensions(screenWidth, screenHeight);
+                ImGui::Text("Resolution: %dx%d, raster %0.2fms", screenWidth, screenHeight, rasterMs);
+                ImGui::Checkbox("Dynamic Resolution", &useDynamicResolution);
+                ImGui::InputFloat("Target Raster (ms)", &dynamicResolution.targetMs);
+            }
+
             if (ImGui::Button(tdjx::render::get_mode_name()))
             {
                 tdjx::render::next_mode();
@@ -255,13 +301,50 @@ int main(int argc, char* argv[])
                 ImGui::Text("Mouse Pos: %d, %d", screenX, screenY);
 
                 LabGame* lab = game->get_game_as<LabGame>();
-                ImGui::InputFloat("Scale", &lab->context.scale);
-                ImGui::InputInt("Base Color", &lab->context.baseColor);
-                ImGui::InputFloat("Color Scale", &lab->context.colorScalar);
+                if (lab)
+                {
+                    int experiment = static_cast<int>(lab->context.experiment);
+                    auto experimentName = [](void*, int index, const char** out)
+                    {
+                        *out = get_experiment_name(static_cast<LabExperiment>(index));
+                        return true;
+                    };
+                    if (ImGui::Combo("Experiment", &experiment, experimentName, nullptr, static_cast<int>(LabExperiment::Count)))
+                    {
+                        lab->context.experiment = static_cast<LabExperiment>(experiment);
+                    }
+
+                    ImGui::InputFloat("Scale", &lab->context.scale);
+                    ImGui::InputInt("Base Color", &lab->context.baseColor);
+                    ImGui::InputFloat("Color Scale", &lab->context.colorScalar);
+                    ImGui::InputInt("Max Iterations", &lab->context.maxIterations);
+                    ImGui::InputInt("Octaves", &lab->context.octaves);
+                    ImGui::Checkbox("Progressive", &lab->context.progressive);
+                    ImGui::InputFloat("Frame Budget (ms)", &lab->context.frameBudgetMs);
+                    ImGui::ProgressBar(lab->get_progress());
+
+                    int interlace = static_cast<int>(lab->context.interlace);
+                    auto interlaceName = [](void*, int index, const char** out)
+                    {
+                        *out = tdjx::gfx::interlace::get_mode_name(static_cast<tdjx::gfx::InterlaceMode>(index));
+                        return true;
+                    };
+                    if (ImGui::Combo("Interlace", &interlace, interlaceName, nullptr, static_cast<int>(tdjx::gfx::InterlaceMode::Count)))
+                    {
+                        lab->context.interlace = static_cast<tdjx::gfx::InterlaceMode>(interlace);
+                    }
+                    ImGui::Checkbox("Motion Rejection", &lab->context.rejectMotion);
+                    if (ImGui::Button("Reset View"))
+                    {
+                        lab->reset_view();
+                    }
+                }
 
                 //tdjx::gfx::point(screenX, screenY, 8);
             }
 
+            tdjx::noise::draw_benchmark_ui();
+            tdjx::jobs::draw_benchmark_ui();
 
             ImGui::End();
         }
@@ -284,6 +367,8 @@ int main(int argc, char* argv[])
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
 
+    tdjx::jobs::shutdown();
+
     SDL_DestroyWindow(window);
     SDL_Quit();
 
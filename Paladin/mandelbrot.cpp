@@ -0,0 +1,260 @@
+#include "mandelbrot.h"
+
+#include <cmath>
+#include <limits>
+
+#include "tdjx_simd.h"
+
+namespace tdjx
+{
+    namespace mandelbrot
+    {
+        // how close an orbit has to come back to its saved point to count as a cycle
+        const float32 kCycleEpsilonF32 = 1e-6f;
+        const float64 kCycleEpsilonF64 = 1e-13;
+
+        template <typename t_real>
+        bool in_cardioid_or_bulb_t(t_real cr, t_real ci)
+        {
+            t_real x = cr - static_cast<t_real>(0.25);
+            t_real ci2 = ci * ci;
+            t_real q = x * x + ci2;
+            if (q * (q + x) <= static_cast<t_real>(0.25) * ci2)
+            {
+                return true;
+            }
+
+            t_real bx = cr + static_cast<t_real>(1);
+            return bx * bx + ci2 <= static_cast<t_real>(1.0 / 16.0);
+        }
+
+        bool in_cardioid_or_bulb(float64 cr, float64 ci)
+        {
+            return in_cardioid_or_bulb_t(cr, ci);
+        }
+
+        float32 smooth_count(int n, float64 magnitudeSqr)
+        {
+            // log|z| = log(|z|^2) / 2, the fractional part is how far past the bailout the last step went
+            float64 mu = n + 1 - std::log2(0.5 * std::log(magnitudeSqr));
+            return static_cast<float32>(mu > 0.0 ? mu : 0.0);
+        }
+
+        template <typename t_real>
+        float32 iterate_point(t_real cr, t_real ci, int maxIterations, t_real epsilon)
+        {
+            if (in_cardioid_or_bulb_t(cr, ci))
+            {
+                return kInterior;
+            }
+
+            const t_real bailout = static_cast<t_real>(kBailout);
+
+            t_real zr = cr, zi = ci;
+            t_real savedR = zr, savedI = zi;
+            int steps = 0, period = 1;
+
+            for (int n = 0; n < maxIterations; ++n)
+            {
+                t_real zr2 = zr * zr;
+                t_real zi2 = zi * zi;
+                t_real magnitude = zr2 + zi2;
+                if (magnitude >= bailout)
+                {
+                    return smooth_count(n, magnitude);
+                }
+
+                zi = (zr + zr) * zi + ci;
+                zr = zr2 - zi2 + cr;
+
+                // brent: compare against a point saved at power of 2 steps, a cycle of any length gets caught
+                // once the window grows past it
+                if (std::abs(zr - savedR) < epsilon && std::abs(zi - savedI) < epsilon)
+                {
+                    return kInterior;
+                }
+
+                if (++steps == period)
+                {
+                    savedR = zr;
+                    savedI = zi;
+                    steps = 0;
+                    period *= 2;
+                }
+            }
+
+            return kInterior;
+        }
+
+        float32 iterate(float64 cr, float64 ci, int maxIterations)
+        {
+            return iterate_point(cr, ci, maxIterations, kCycleEpsilonF64);
+        }
+
+        // thin wrappers so the same kernel runs as 8 floats or 4 doubles
+
+        struct simd_f32
+        {
+            typedef __m256 reg;
+            typedef float32 real;
+            static const int kLanes = 8;
+
+            TDJX_TARGET_AVX2 static reg set1(real v) { return _mm256_set1_ps(v); }
+            TDJX_TARGET_AVX2 static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg ge(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            TDJX_TARGET_AVX2 static reg le(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+            TDJX_TARGET_AVX2 static reg lt(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            TDJX_TARGET_AVX2 static reg and_(reg a, reg b) { return _mm256_and_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg or_(reg a, reg b) { return _mm256_or_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg andnot(reg a, reg b) { return _mm256_andnot_ps(a, b); }
+            TDJX_TARGET_AVX2 static reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            TDJX_TARGET_AVX2 static int mask(reg a) { return _mm256_movemask_ps(a); }
+            TDJX_TARGET_AVX2 static void store(real* out, reg a) { _mm256_storeu_ps(out, a); }
+            TDJX_TARGET_AVX2 static reg lanes(real x0, real dx, int i)
+            {
+                __m256 index = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+                return _mm256_add_ps(_mm256_set1_ps(x0), _mm256_mul_ps(index, _mm256_set1_ps(dx)));
+            }
+        };
+
+        struct simd_f64
+        {
+            typedef __m256d reg;
+            typedef float64 real;
+            static const int kLanes = 4;
+
+            TDJX_TARGET_AVX2 static reg set1(real v) { return _mm256_set1_pd(v); }
+            TDJX_TARGET_AVX2 static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg ge(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+            TDJX_TARGET_AVX2 static reg le(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+            TDJX_TARGET_AVX2 static reg lt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+            TDJX_TARGET_AVX2 static reg and_(reg a, reg b) { return _mm256_and_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg or_(reg a, reg b) { return _mm256_or_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg andnot(reg a, reg b) { return _mm256_andnot_pd(a, b); }
+            TDJX_TARGET_AVX2 static reg abs(reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+            TDJX_TARGET_AVX2 static int mask(reg a) { return _mm256_movemask_pd(a); }
+            TDJX_TARGET_AVX2 static void store(real* out, reg a) { _mm256_storeu_pd(out, a); }
+            TDJX_TARGET_AVX2 static reg lanes(real x0, real dx, int i)
+            {
+                __m256d index = _mm256_cvtepi32_pd(_mm_add_epi32(_mm_set1_epi32(i), _mm_setr_epi32(0, 1, 2, 3)));
+                return _mm256_add_pd(_mm256_set1_pd(x0), _mm256_mul_pd(index, _mm256_set1_pd(dx)));
+            }
+        };
+
+        // one group of lanes through the same steps as iterate_point. lanes that escape or cycle drop out of
+        // the active mask and the group stops as soon as none are left
+        template <typename t_simd>
+        TDJX_TARGET_AVX2
+        static void iterate_lanes(typename t_simd::reg cr, typename t_simd::real ci, int maxIterations,
+            typename t_simd::real epsilon, float32* out)
+        {
+            typedef typename t_simd::reg reg;
+            typedef typename t_simd::real real;
+            const int kLanes = t_simd::kLanes;
+
+            reg ci4 = t_simd::set1(ci);
+            reg ci2 = t_simd::mul(ci4, ci4);
+
+            reg x = t_simd::sub(cr, t_simd::set1(static_cast<real>(0.25)));
+            reg q = t_simd::add(t_simd::mul(x, x), ci2);
+            reg cardioid = t_simd::le(t_simd::mul(q, t_simd::add(q, x)), t_simd::mul(t_simd::set1(static_cast<real>(0.25)), ci2));
+            reg bx = t_simd::add(cr, t_simd::set1(static_cast<real>(1)));
+            reg bulb = t_simd::le(t_simd::add(t_simd::mul(bx, bx), ci2), t_simd::set1(static_cast<real>(1.0 / 16.0)));
+
+            reg allOnes = t_simd::ge(cr, t_simd::set1(-std::numeric_limits<real>::infinity()));
+            reg active = t_simd::andnot(t_simd::or_(cardioid, bulb), allOnes);
+
+            for (int lane = 0; lane < kLanes; ++lane)
+            {
+                out[lane] = kInterior;
+            }
+
+            const reg bailout = t_simd::set1(static_cast<real>(kBailout));
+            const reg eps = t_simd::set1(epsilon);
+
+            reg zr = cr, zi = ci4;
+            reg savedR = zr, savedI = zi;
+            int steps = 0, period = 1;
+
+            for (int n = 0; n < maxIterations; ++n)
+            {
+                int live = t_simd::mask(active);
+                if (live == 0)
+                {
+                    break;
+                }
+
+                reg zr2 = t_simd::mul(zr, zr);
+                reg zi2 = t_simd::mul(zi, zi);
+                reg magnitude = t_simd::add(zr2, zi2);
+
+                reg escapedMask = t_simd::ge(magnitude, bailout);
+                int escaped = t_simd::mask(escapedMask) & live;
+                if (escaped)
+                {
+                    real magnitudes[kLanes];
+                    t_simd::store(magnitudes, magnitude);
+                    for (int lane = 0; lane < kLanes; ++lane)
+                    {
+                        if (escaped & (1 << lane))
+                        {
+                            out[lane] = smooth_count(n, magnitudes[lane]);
+                        }
+                    }
+                    active = t_simd::andnot(escapedMask, active);
+                }
+
+                zi = t_simd::add(t_simd::mul(t_simd::add(zr, zr), zi), ci4);
+                zr = t_simd::add(t_simd::sub(zr2, zi2), cr);
+
+                reg cycled = t_simd::and_(
+                    t_simd::lt(t_simd::abs(t_simd::sub(zr, savedR)), eps),
+                    t_simd::lt(t_simd::abs(t_simd::sub(zi, savedI)), eps));
+                active = t_simd::andnot(cycled, active);
+
+                if (++steps == period)
+                {
+                    savedR = zr;
+                    savedI = zi;
+                    steps = 0;
+                    period *= 2;
+                }
+            }
+        }
+
+        template <typename t_simd>
+        TDJX_TARGET_AVX2
+        static int iterate_row_avx2(typename t_simd::real x0, typename t_simd::real dx, typename t_simd::real y,
+            int count, int maxIterations, typename t_simd::real epsilon, float32* out)
+        {
+            int i = 0;
+            for (; i + t_simd::kLanes <= count; i += t_simd::kLanes)
+            {
+                iterate_lanes<t_simd>(t_simd::lanes(x0, dx, i), y, maxIterations, epsilon, out + i);
+            }
+            return i;
+        }
+
+        void iterate_row(float32 x0, float32 dx, float32 y, int count, int maxIterations, float32* out)
+        {
+            int done = util::cpu_has_avx2() ? iterate_row_avx2<simd_f32>(x0, dx, y, count, maxIterations, kCycleEpsilonF32, out) : 0;
+            for (int i = done; i < count; ++i)
+            {
+                out[i] = iterate_point(x0 + static_cast<float32>(i) * dx, y, maxIterations, kCycleEpsilonF32);
+            }
+        }
+
+        void iterate_row(float64 x0, float64 dx, float64 y, int count, int maxIterations, float32* out)
+        {
+            int done = util::cpu_has_avx2() ? iterate_row_avx2<simd_f64>(x0, dx, y, count, maxIterations, kCycleEpsilonF64, out) : 0;
+            for (int i = done; i < count; ++i)
+            {
+                out[i] = iterate_point(x0 + static_cast<float64>(i) * dx, y, maxIterations, kCycleEpsilonF64);
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+
+#include "types.h"
+
+// escape time mandelbrot kernels. each call walks a row of points c = (x0 + i * dx, y) and writes a smooth
+// (fractional) iteration count per point, or kInterior for points that never escape. points inside the main
+// cardioid or the period 2 bulb are rejected before iterating, and orbits that settle into a cycle are caught
+// with brent's method so deep interior views don't burn the full iteration budget on every pixel.
+// with avx2 the float version runs 8 points at a time and the double version 4, lanes drop out as they finish.
+
+namespace tdjx
+{
+    namespace mandelbrot
+    {
+        const float32 kInterior = -1.0f;
+
+        // squared escape radius, large enough that the smooth count doesn't band
+        const float64 kBailout = 256.0;
+
+        // float runs out of precision once a pixel is smaller than about this relative to the view position
+        const float64 kFloatPrecisionLimit = 1e-6;
+        // same for double, past this it's perturbation from a high precision reference (mandelbrot_deep.h)
+        const float64 kDoublePrecisionLimit = 1e-13;
+
+        bool in_cardioid_or_bulb(float64 cr, float64 ci);
+
+        // fractional iteration count for a point that escaped on iteration n with |z|^2 = magnitudeSqr
+        float32 smooth_count(int n, float64 magnitudeSqr);
+
+        float32 iterate(float64 cr, float64 ci, int maxIterations);
+
+        void iterate_row(float32 x0, float32 dx, float32 y, int count, int maxIterations, float32* out);
+        void iterate_row(float64 x0, float64 dx, float64 y, int count, int maxIterations, float32* out);
+
+        // two counts land on the same colour band, both interior or escaping on the same iteration
+        inline bool same_band(float32 a, float32 b)
+        {
+            return (a == kInterior || b == kInterior) ? a == b : static_cast<int>(a) == static_cast<int>(b);
+        }
+
+        // mariani-silver. the border of a box is sampled and if it all comes back in one band the inside is filled
+        // without iterating, otherwise the box is split and each half gets the same treatment. the set is connected
+        // so a box whose border is all interior can't hide anything outside it. sample(x, y, count, out) fills a
+        // run of count pixels on row y starting at x, counts is the whole buffer with stride between rows
+        template <typename t_sample>
+        void subdivide_box(int x0, int y0, int x1, int y1, float32* counts, int stride, t_sample& sample);
+
+        template <typename t_sample>
+        void subdivide(int x0, int y0, int x1, int y1, float32* counts, int stride, t_sample&& sample)
+        {
+            if (x0 > x1 || y0 > y1)
+            {
+                return;
+            }
+
+            int w = x1 - x0 + 1;
+            sample(x0, y0, w, counts + y0 * stride + x0);
+            if (y1 > y0)
+            {
+                sample(x0, y1, w, counts + y1 * stride + x0);
+            }
+            for (int y = y0 + 1; y < y1; ++y)
+            {
+                sample(x0, y, 1, counts + y * stride + x0);
+                if (x1 > x0)
+                {
+                    sample(x1, y, 1, counts + y * stride + x1);
+                }
+            }
+
+            subdivide_box(x0, y0, x1, y1, counts, stride, sample);
+        }
+
+        // boxes this small or smaller just get iterated
+        const int kMinSubdivideSize = 4;
+
+        // border of the box is already in counts
+        template <typename t_sample>
+        void subdivide_box(int x0, int y0, int x1, int y1, float32* counts, int stride, t_sample& sample)
+        {
+            if (x1 - x0 < 2 || y1 - y0 < 2)
+            {
+                return;
+            }
+
+            float32 first = counts[y0 * stride + x0];
+            bool uniform = true;
+            for (int x = x0; x <= x1 && uniform; ++x)
+            {
+                uniform = same_band(first, counts[y0 * stride + x]) && same_band(first, counts[y1 * stride + x]);
+            }
+            for (int y = y0 + 1; y < y1 && uniform; ++y)
+            {
+                uniform = same_band(first, counts[y * stride + x0]) && same_band(first, counts[y * stride + x1]);
+            }
+
+            if (uniform)
+            {
+                for (int y = y0 + 1; y < y1; ++y)
+                {
+                    std::fill(counts + y * stride + x0 + 1, counts + y * stride + x1, first);
+                }
+                return;
+            }
+
+            if (x1 - x0 <= kMinSubdivideSize || y1 - y0 <= kMinSubdivideSize)
+            {
+                for (int y = y0 + 1; y < y1; ++y)
+                {
+                    sample(x0 + 1, y, x1 - x0 - 1, counts + y * stride + x0 + 1);
+                }
+                return;
+            }
+
+            // split across the longer side, the split line becomes a shared edge of both halves
+            if (x1 - x0 >= y1 - y0)
+            {
+                int xm = (x0 + x1) / 2;
+                for (int y = y0 + 1; y < y1; ++y)
+                {
+                    sample(xm, y, 1, counts + y * stride + xm);
+                }
+                subdivide_box(x0, y0, xm, y1, counts, stride, sample);
+                subdivide_box(xm, y0, x1, y1, counts, stride, sample);
+            }
+            else
+            {
+                int ym = (y0 + y1) / 2;
+                sample(x0 + 1, ym, x1 - x0 - 1, counts + ym * stride + x0 + 1);
+                subdivide_box(x0, y0, x1, ym, counts, stride, sample);
+                subdivide_box(x0, ym, x1, y1, counts, stride, sample);
+            }
+        }
+    }
+}
@@ -0,0 +1,402 @@
+#include "mandelbrot_deep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mandelbrot.h"
+#include "tdjx_simd.h"
+
+namespace tdjx
+{
+    namespace mandelbrot
+    {
+        // the series stops once its cubic term gets this big next to its linear one
+        const float64 kSeriesTolerance = 1e-12;
+
+        namespace fixed
+        {
+            // -1, 0 or 1 comparing magnitudes only
+            int compare_magnitude(const Fixed& a, const Fixed& b)
+            {
+                for (int i = 0; i < kFixedLimbs; ++i)
+                {
+                    if (a.limbs[i] != b.limbs[i])
+                    {
+                        return (a.limbs[i] < b.limbs[i]) ? -1 : 1;
+                    }
+                }
+                return 0;
+            }
+
+            void add_magnitude(const Fixed& a, const Fixed& b, Fixed& out)
+            {
+                uint64 carry = 0;
+                for (int i = kFixedLimbs - 1; i >= 0; --i)
+                {
+                    uint64 sum = static_cast<uint64>(a.limbs[i]) + b.limbs[i] + carry;
+                    out.limbs[i] = static_cast<uint32>(sum);
+                    carry = sum >> 32;
+                }
+            }
+
+            // a must be at least as big as b
+            void sub_magnitude(const Fixed& a, const Fixed& b, Fixed& out)
+            {
+                int64 borrow = 0;
+                for (int i = kFixedLimbs - 1; i >= 0; --i)
+                {
+                    int64 difference = static_cast<int64>(a.limbs[i]) - b.limbs[i] - borrow;
+                    borrow = (difference < 0) ? 1 : 0;
+                    out.limbs[i] = static_cast<uint32>(difference + (borrow << 32));
+                }
+            }
+
+            Fixed from_double(float64 value)
+            {
+                Fixed result;
+                result.negative = value < 0;
+
+                float64 magnitude = std::abs(value);
+                for (int i = 0; i < kFixedLimbs; ++i)
+                {
+                    float64 whole = std::floor(magnitude);
+                    result.limbs[i] = static_cast<uint32>(whole);
+                    magnitude = (magnitude - whole) * 4294967296.0;
+                }
+                return result;
+            }
+
+            float64 to_double(const Fixed& self)
+            {
+                // past the third limb nothing survives the rounding to 53 bits
+                float64 value = self.limbs[0] + self.limbs[1] / 4294967296.0 + self.limbs[2] / 18446744073709551616.0;
+                return self.negative ? -value : value;
+            }
+
+            Fixed add(const Fixed& a, const Fixed& b)
+            {
+                Fixed result;
+                if (a.negative == b.negative)
+                {
+                    add_magnitude(a, b, result);
+                    result.negative = a.negative;
+                }
+                else if (compare_magnitude(a, b) >= 0)
+                {
+                    sub_magnitude(a, b, result);
+                    result.negative = a.negative;
+                }
+                else
+                {
+                    sub_magnitude(b, a, result);
+                    result.negative = b.negative;
+                }
+                return result;
+            }
+
+            Fixed sub(const Fixed& a, const Fixed& b)
+            {
+                Fixed negated = b;
+                negated.negative = !b.negative;
+                return add(a, negated);
+            }
+
+            Fixed mul(const Fixed& a, const Fixed& b)
+            {
+                // limb i has weight 2^(-32 i) so a product of limbs i and j lands on limb i + j. the low half of
+                // each 64 bit product goes there and the high half one limb up, keeping every column inside 64 bits
+                uint64 columns[kFixedLimbs] = {};
+                for (int i = 0; i < kFixedLimbs; ++i)
+                {
+                    if (a.limbs[i] == 0)
+                    {
+                        continue;
+                    }
+
+                    for (int j = 0; i + j <= kFixedLimbs && j < kFixedLimbs; ++j)
+                    {
+                        uint64 product = static_cast<uint64>(a.limbs[i]) * b.limbs[j];
+                        int k = i + j;
+                        if (k < kFixedLimbs)
+                        {
+                            columns[k] += product & 0xffffffffu;
+                        }
+                        if (k > 0)
+                        {
+                            columns[k - 1] += product >> 32;
+                        }
+                    }
+                }
+
+                Fixed result;
+                uint64 carry = 0;
+                for (int k = kFixedLimbs - 1; k >= 0; --k)
+                {
+                    uint64 sum = columns[k] + carry;
+                    result.limbs[k] = static_cast<uint32>(sum);
+                    carry = sum >> 32;
+                }
+                result.negative = a.negative != b.negative;
+                return result;
+            }
+        }
+
+        void build_reference(const DeepView& view, int maxIterations, float64 seriesRadius, ReferenceOrbit& out)
+        {
+            out.zr.clear();
+            out.zi.clear();
+            out.zr.reserve(maxIterations + 1);
+            out.zi.reserve(maxIterations + 1);
+
+            Fixed zr, zi;
+            for (int n = 0; n <= maxIterations; ++n)
+            {
+                // Z_0 and Z_1 always go in so a pixel that rebases has somewhere to step to
+                float64 dr = fixed::to_double(zr);
+                float64 di = fixed::to_double(zi);
+                if (n > 1 && dr * dr + di * di >= kBailout)
+                {
+                    break;
+                }
+
+                out.zr.push_back(dr);
+                out.zi.push_back(di);
+
+                Fixed zr2 = fixed::mul(zr, zr);
+                Fixed zi2 = fixed::mul(zi, zi);
+                Fixed zri = fixed::mul(zr, zi);
+                zi = fixed::add(fixed::add(zri, zri), view.centerY);
+                zr = fixed::add(fixed::sub(zr2, zi2), view.centerX);
+            }
+
+            // series coefficients, scaled by powers of the radius so nothing underflows at deep zooms
+            float64 ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0;
+            out.skip = 0;
+            out.seriesRadius = seriesRadius;
+            out.ar = out.ai = out.br = out.bi = out.cr = out.ci = 0;
+
+            int last = static_cast<int>(out.zr.size()) - 1;
+            for (int n = 0; n < last && n < maxIterations - 1; ++n)
+            {
+                float64 zr2 = 2 * out.zr[n], zi2 = 2 * out.zi[n];
+
+                // a' = 2Za + r, b' = 2Zb + a^2, c' = 2Zc + 2ab
+                float64 nar = zr2 * ar - zi2 * ai + seriesRadius;
+                float64 nai = zr2 * ai + zi2 * ar;
+                float64 nbr = zr2 * br - zi2 * bi + (ar * ar - ai * ai);
+                float64 nbi = zr2 * bi + zi2 * br + 2 * ar * ai;
+                float64 ncr = zr2 * cr - zi2 * ci + 2 * (ar * br - ai * bi);
+                float64 nci = zr2 * ci + zi2 * cr + 2 * (ar * bi + ai * br);
+
+                if (std::hypot(ncr, nci) > kSeriesTolerance * std::hypot(nar, nai))
+                {
+                    break;
+                }
+
+                ar = nar; ai = nai;
+                br = nbr; bi = nbi;
+                cr = ncr; ci = nci;
+
+                out.skip = n + 1;
+                out.ar = ar; out.ai = ai;
+                out.br = br; out.bi = bi;
+                out.cr = cr; out.ci = ci;
+            }
+        }
+
+        void series_start(const ReferenceOrbit& orbit, float64 dcr, float64 dci, float64& dr, float64& di)
+        {
+            float64 ur = dcr / orbit.seriesRadius, ui = dci / orbit.seriesRadius;
+            float64 u2r = ur * ur - ui * ui, u2i = 2 * ur * ui;
+            float64 u3r = u2r * ur - u2i * ui, u3i = u2r * ui + u2i * ur;
+            dr = orbit.ar * ur - orbit.ai * ui + orbit.br * u2r - orbit.bi * u2i + orbit.cr * u3r - orbit.ci * u3i;
+            di = orbit.ar * ui + orbit.ai * ur + orbit.br * u2i + orbit.bi * u2r + orbit.cr * u3i + orbit.ci * u3r;
+        }
+
+        float32 iterate_perturbed(const ReferenceOrbit& orbit, float64 dcr, float64 dci, int maxIterations)
+        {
+            const float64* refR = orbit.zr.data();
+            const float64* refI = orbit.zi.data();
+            int last = static_cast<int>(orbit.zr.size()) - 1;
+
+            // start where the series leaves off
+            float64 dr, di;
+            series_start(orbit, dcr, dci, dr, di);
+
+            // n is the index into Z where iterate_point starts from z = c, one step in, so counts come out one
+            // lower here and the palette doesn't jump a band going past kDoublePrecisionLimit
+            int m = orbit.skip;
+            for (int n = orbit.skip; n <= maxIterations; ++n)
+            {
+                float64 zr = refR[m] + dr;
+                float64 zi = refI[m] + di;
+                float64 magnitude = zr * zr + zi * zi;
+                if (magnitude >= kBailout)
+                {
+                    return smooth_count(n - 1, magnitude);
+                }
+
+                // once the pixel is closer to 0 than to the reference (or the reference has run out) its delta
+                // has stopped being small, carry on from the start of the reference where Z is 0
+                if (magnitude < dr * dr + di * di || m == last)
+                {
+                    dr = zr;
+                    di = zi;
+                    m = 0;
+                }
+
+                // d' = (2Z + d)d + dc
+                float64 tr = 2 * refR[m] + dr;
+                float64 ti = 2 * refI[m] + di;
+                float64 nr = tr * dr - ti * di + dcr;
+                float64 ni = tr * di + ti * dr + dci;
+                dr = nr;
+                di = ni;
+                ++m;
+            }
+
+            return kInterior;
+        }
+
+        // same steps as iterate_perturbed 4 pixels at a time. pixels take wildly different numbers of iterations
+        // this deep so a lane that finishes picks up the next pixel in the row straight away instead of idling
+        TDJX_TARGET_AVX2
+        static void iterate_row_perturbed_avx2(const ReferenceOrbit& orbit, float64 dx0, float64 dx, float64 dy,
+            int count, int maxIterations, float32* out)
+        {
+            const float64* refR = orbit.zr.data();
+            const float64* refI = orbit.zi.data();
+            const int last = static_cast<int>(orbit.zr.size()) - 1;
+
+            alignas(32) float64 laneDr[4], laneDi[4], laneCr[4], laneN[4], laneMagnitude[4];
+            alignas(16) int32 laneM[4];
+            int lanePixel[4];
+            int live = 0;
+            int nextPixel = 0;
+
+            auto start_lane = [&](int lane)
+            {
+                if (nextPixel >= count)
+                {
+                    // parked on a harmless spot in the reference until the rest finish
+                    laneDr[lane] = laneDi[lane] = laneCr[lane] = 0;
+                    laneM[lane] = 0;
+                    laneN[lane] = 0;
+                    live &= ~(1 << lane);
+                    return;
+                }
+
+                int pixel = nextPixel++;
+                lanePixel[lane] = pixel;
+                laneCr[lane] = dx0 + pixel * dx;
+                series_start(orbit, laneCr[lane], dy, laneDr[lane], laneDi[lane]);
+                laneM[lane] = orbit.skip;
+                laneN[lane] = orbit.skip;
+                live |= 1 << lane;
+            };
+
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                start_lane(lane);
+            }
+
+            const __m256d bailout = _mm256_set1_pd(kBailout);
+            const __m256d limit = _mm256_set1_pd(maxIterations + 1);
+            const __m256d two = _mm256_set1_pd(2.0);
+            const __m256d one = _mm256_set1_pd(1.0);
+            const __m256d ci = _mm256_set1_pd(dy);
+            const __m128i lastIndex = _mm_set1_epi32(last);
+            const __m128i onei = _mm_set1_epi32(1);
+
+            __m256d dr = _mm256_load_pd(laneDr), di = _mm256_load_pd(laneDi);
+            __m256d cr = _mm256_load_pd(laneCr), n = _mm256_load_pd(laneN);
+            __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(laneM));
+
+            while (live)
+            {
+                __m256d refZr = _mm256_i32gather_pd(refR, m, 8);
+                __m256d refZi = _mm256_i32gather_pd(refI, m, 8);
+                __m256d zr = _mm256_add_pd(refZr, dr);
+                __m256d zi = _mm256_add_pd(refZi, di);
+                __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zr, zr), _mm256_mul_pd(zi, zi));
+
+                int outOfTime = _mm256_movemask_pd(_mm256_cmp_pd(n, limit, _CMP_GE_OQ)) & live;
+                int escaped = _mm256_movemask_pd(_mm256_cmp_pd(magnitude, bailout, _CMP_GE_OQ)) & live & ~outOfTime;
+                if (outOfTime | escaped)
+                {
+                    _mm256_store_pd(laneDr, dr);
+                    _mm256_store_pd(laneDi, di);
+                    _mm256_store_pd(laneCr, cr);
+                    _mm256_store_pd(laneN, n);
+                    _mm256_store_pd(laneMagnitude, magnitude);
+                    _mm_store_si128(reinterpret_cast<__m128i*>(laneM), m);
+
+                    for (int lane = 0; lane < 4; ++lane)
+                    {
+                        int bit = 1 << lane;
+                        if (outOfTime & bit)
+                        {
+                            out[lanePixel[lane]] = kInterior;
+                            start_lane(lane);
+                        }
+                        else if (escaped & bit)
+                        {
+                            out[lanePixel[lane]] = smooth_count(static_cast<int>(laneN[lane]) - 1, laneMagnitude[lane]);
+                            start_lane(lane);
+                        }
+                    }
+
+                    dr = _mm256_load_pd(laneDr);
+                    di = _mm256_load_pd(laneDi);
+                    cr = _mm256_load_pd(laneCr);
+                    n = _mm256_load_pd(laneN);
+                    m = _mm_load_si128(reinterpret_cast<const __m128i*>(laneM));
+                    continue;
+                }
+
+                __m256d rebaseClose = _mm256_cmp_pd(magnitude, _mm256_add_pd(_mm256_mul_pd(dr, dr), _mm256_mul_pd(di, di)), _CMP_LT_OQ);
+                __m256d rebaseEnd = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(m, lastIndex)));
+                __m256d rebase = _mm256_or_pd(rebaseClose, rebaseEnd);
+                if (_mm256_movemask_pd(rebase))
+                {
+                    dr = _mm256_blendv_pd(dr, zr, rebase);
+                    di = _mm256_blendv_pd(di, zi, rebase);
+                    refZr = _mm256_andnot_pd(rebase, refZr);
+                    refZi = _mm256_andnot_pd(rebase, refZi);
+                    __m256i rebaseLow = _mm256_permutevar8x32_epi32(_mm256_castpd_si256(rebase), _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+                    m = _mm_andnot_si128(_mm256_castsi256_si128(rebaseLow), m);
+                }
+
+                __m256d tr = _mm256_add_pd(_mm256_mul_pd(two, refZr), dr);
+                __m256d ti = _mm256_add_pd(_mm256_mul_pd(two, refZi), di);
+                __m256d nr = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(tr, dr), _mm256_mul_pd(ti, di)), cr);
+                __m256d ni = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(tr, di), _mm256_mul_pd(ti, dr)), ci);
+                dr = nr;
+                di = ni;
+                m = _mm_add_epi32(m, onei);
+                n = _mm256_add_pd(n, one);
+            }
+        }
+
+        void iterate_row_perturbed(const ReferenceOrbit& orbit, float64 dx0, float64 dx, float64 dy,
+            int count, int maxIterations, float32* out)
+        {
+            if (orbit.zr.empty())
+            {
+                std::fill(out, out + count, kInterior);
+                return;
+            }
+
+            if (util::cpu_has_avx2() && count >= 4)
+            {
+                iterate_row_perturbed_avx2(orbit, dx0, dx, dy, count, maxIterations, out);
+                return;
+            }
+
+            for (int i = 0; i < count; ++i)
+            {
+                out[i] = iterate_perturbed(orbit, dx0 + i * dx, dy, maxIterations);
+            }
+        }
+    }
+}
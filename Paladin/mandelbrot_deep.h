@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+// deep zoom mandelbrot by perturbation. one reference orbit through the centre of the view is iterated in high
+// precision fixed point, every pixel then only tracks its (tiny) difference from that orbit in doubles. a cubic
+// series skips the iterations where every pixel still moves in lockstep with the reference, and pixels whose
+// difference grows bigger than the orbit itself (the usual source of glitches) rebase onto the start of the
+// reference. the centre only has kFixedLimbs worth of precision, so zooms stop at kMinRadius.
+
+namespace tdjx
+{
+    namespace mandelbrot
+    {
+        // 1 integer limb followed by fraction limbs, about 1e-67 resolution
+        const int kFixedLimbs = 8;
+
+        // smallest view radius, keeps pixels over a hundred thousand times bigger than the centre's resolution
+        const float64 kMinRadius = 1e-60;
+
+        // sign and magnitude, limbs[0] is the integer part and the rest are most significant first
+        struct Fixed
+        {
+            uint32 limbs[kFixedLimbs] = {};
+            bool negative = false;
+        };
+
+        namespace fixed
+        {
+            Fixed from_double(float64 value);
+            float64 to_double(const Fixed& self);
+
+            Fixed add(const Fixed& a, const Fixed& b);
+            Fixed sub(const Fixed& a, const Fixed& b);
+            Fixed mul(const Fixed& a, const Fixed& b);
+        }
+
+        struct DeepView
+        {
+            Fixed centerX;
+            Fixed centerY;
+            // half the view height
+            float64 radius = 1.5;
+        };
+
+        struct ReferenceOrbit
+        {
+            // Z_0 (always 0) onward until the orbit escapes or hits the iteration limit
+            std::vector<float64> zr;
+            std::vector<float64> zi;
+
+            // iterations every pixel within seriesRadius of the centre can skip, and the series coefficients there.
+            // they're scaled by the radius so delta = a * u + b * u^2 + c * u^3 with u = dc / seriesRadius
+            int skip = 0;
+            float64 seriesRadius = 0;
+            float64 ar = 0, ai = 0;
+            float64 br = 0, bi = 0;
+            float64 cr = 0, ci = 0;
+        };
+
+        // seriesRadius should cover the furthest pixel from the centre
+        void build_reference(const DeepView& view, int maxIterations, float64 seriesRadius, ReferenceOrbit& out);
+
+        // row of pixels at dc = (dx0 + i * dx, dy) from the view centre, same output as iterate_row
+        void iterate_row_perturbed(const ReferenceOrbit& orbit, float64 dx0, float64 dx, float64 dy,
+            int count, int maxIterations, float32* out);
+    }
+}
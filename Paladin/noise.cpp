@@ -0,0 +1,910 @@
+#include "noise.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "imgui.h"
+#include "perlin.h"
+#include "tdjx_simd.h"
+
+namespace tdjx
+{
+    namespace noise
+    {
+        // skew/unskew factors, (sqrt(n + 1) - 1) / n and (n + 1 - sqrt(n + 1)) / (n * (n + 1))
+        const float32 k_f2 = 0.366025403f;
+        const float32 k_g2 = 0.211324865f;
+        const float32 k_f3 = 1.0f / 3.0f;
+        const float32 k_g3 = 1.0f / 6.0f;
+        const float32 k_f4 = 0.309016994f;
+        const float32 k_g4 = 0.138196601f;
+
+        // scales that bring each dimension's output out to roughly [-1..1]
+        const float32 k_scale2 = 70.0f;
+        const float32 k_scale3 = 32.0f;
+        const float32 k_scale4 = 27.0f;
+
+        // gradients split into components so the simd paths can gather them
+        const float32 k_grad3X[12] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0 };
+        const float32 k_grad3Y[12] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1 };
+        const float32 k_grad3Z[12] = { 0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1 };
+
+        const float32 k_grad4X[32] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, -1, -1, -1, -1,
+            1, 1, 1, 1, -1, -1, -1, -1, 1, 1, 1, 1, -1, -1, -1, -1 };
+        const float32 k_grad4Y[32] = {
+            1, 1, 1, 1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0,
+            1, 1, -1, -1, 1, 1, -1, -1, 1, 1, -1, -1, 1, 1, -1, -1 };
+        const float32 k_grad4Z[32] = {
+            1, 1, -1, -1, 1, 1, -1, -1, 1, 1, -1, -1, 1, 1, -1, -1,
+            0, 0, 0, 0, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1 };
+        const float32 k_grad4W[32] = {
+            1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1, 1, -1,
+            1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+        void seed(Simplex& self, uint32 seed)
+        {
+            int32 p[256];
+            std::iota(&p[0], &p[256], 0);
+            std::default_random_engine engine(seed);
+            std::shuffle(&p[0], &p[256], engine);
+
+            for (int i = 0; i < 512; ++i)
+            {
+                self.perm[i] = p[i & 255];
+                self.permMod12[i] = p[i & 255] % 12;
+            }
+
+            std::fill(&self.perm[512], &self.perm[520], 0);
+            std::fill(&self.permMod12[512], &self.permMod12[520], 0);
+        }
+
+        // scalar
+
+        inline float32 corner2(float32 x, float32 y, int g)
+        {
+            float32 t = 0.5f - x * x - y * y;
+            if (t < 0.0f)
+            {
+                return 0.0f;
+            }
+            t *= t;
+            return t * t * (k_grad3X[g] * x + k_grad3Y[g] * y);
+        }
+
+        inline float32 corner3(float32 x, float32 y, float32 z, int g)
+        {
+            float32 t = 0.6f - x * x - y * y - z * z;
+            if (t < 0.0f)
+            {
+                return 0.0f;
+            }
+            t *= t;
+            return t * t * (k_grad3X[g] * x + k_grad3Y[g] * y + k_grad3Z[g] * z);
+        }
+
+        inline float32 corner4(float32 x, float32 y, float32 z, float32 w, int g)
+        {
+            float32 t = 0.6f - x * x - y * y - z * z - w * w;
+            if (t < 0.0f)
+            {
+                return 0.0f;
+            }
+            t *= t;
+            return t * t * (k_grad4X[g] * x + k_grad4Y[g] * y + k_grad4Z[g] * z + k_grad4W[g] * w);
+        }
+
+        float32 simplex2(const Simplex& self, float32 x, float32 y)
+        {
+            float32 s = (x + y) * k_f2;
+            float32 fi = std::floor(x + s);
+            float32 fj = std::floor(y + s);
+            float32 t = (fi + fj) * k_g2;
+
+            float32 x0 = x - (fi - t);
+            float32 y0 = y - (fj - t);
+
+            // which of the two triangles in the skewed cell we're in
+            float32 i1 = (x0 > y0) ? 1.0f : 0.0f;
+            float32 j1 = 1.0f - i1;
+
+            float32 x1 = x0 - i1 + k_g2;
+            float32 y1 = y0 - j1 + k_g2;
+            float32 x2 = x0 - 1.0f + 2.0f * k_g2;
+            float32 y2 = y0 - 1.0f + 2.0f * k_g2;
+
+            int ii = static_cast<int>(fi) & 255;
+            int jj = static_cast<int>(fj) & 255;
+            int oi = static_cast<int>(i1);
+            int oj = static_cast<int>(j1);
+
+            const int32* perm = self.perm;
+            const int32* mod = self.permMod12;
+
+            float32 n0 = corner2(x0, y0, mod[ii + perm[jj]]);
+            float32 n1 = corner2(x1, y1, mod[ii + oi + perm[jj + oj]]);
+            float32 n2 = corner2(x2, y2, mod[ii + 1 + perm[jj + 1]]);
+
+            return k_scale2 * (n0 + n1 + n2);
+        }
+
+        float32 simplex3(const Simplex& self, float32 x, float32 y, float32 z)
+        {
+            float32 s = (x + y + z) * k_f3;
+            float32 fi = std::floor(x + s);
+            float32 fj = std::floor(y + s);
+            float32 fk = std::floor(z + s);
+            float32 t = (fi + fj + fk) * k_g3;
+
+            float32 x0 = x - (fi - t);
+            float32 y0 = y - (fj - t);
+            float32 z0 = z - (fk - t);
+
+            // rank the offsets to find which of the six tetrahedra we're in
+            float32 i1, j1, k1, i2, j2, k2;
+            if (x0 >= y0)
+            {
+                if (y0 >= z0) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+                else if (x0 >= z0) { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; }
+                else { i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; }
+            }
+            else
+            {
+                if (y0 < z0) { i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; }
+                else if (x0 < z0) { i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; }
+                else { i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+            }
+
+            float32 x1 = x0 - i1 + k_g3;
+            float32 y1 = y0 - j1 + k_g3;
+            float32 z1 = z0 - k1 + k_g3;
+            float32 x2 = x0 - i2 + 2.0f * k_g3;
+            float32 y2 = y0 - j2 + 2.0f * k_g3;
+            float32 z2 = z0 - k2 + 2.0f * k_g3;
+            float32 x3 = x0 - 1.0f + 3.0f * k_g3;
+            float32 y3 = y0 - 1.0f + 3.0f * k_g3;
+            float32 z3 = z0 - 1.0f + 3.0f * k_g3;
+
+            int ii = static_cast<int>(fi) & 255;
+            int jj = static_cast<int>(fj) & 255;
+            int kk = static_cast<int>(fk) & 255;
+
+            const int32* perm = self.perm;
+            const int32* mod = self.permMod12;
+            int a1 = static_cast<int>(i1), b1 = static_cast<int>(j1), c1 = static_cast<int>(k1);
+            int a2 = static_cast<int>(i2), b2 = static_cast<int>(j2), c2 = static_cast<int>(k2);
+
+            float32 n0 = corner3(x0, y0, z0, mod[ii + perm[jj + perm[kk]]]);
+            float32 n1 = corner3(x1, y1, z1, mod[ii + a1 + perm[jj + b1 + perm[kk + c1]]]);
+            float32 n2 = corner3(x2, y2, z2, mod[ii + a2 + perm[jj + b2 + perm[kk + c2]]]);
+            float32 n3 = corner3(x3, y3, z3, mod[ii + 1 + perm[jj + 1 + perm[kk + 1]]]);
+
+            return k_scale3 * (n0 + n1 + n2 + n3);
+        }
+
+        float32 simplex4(const Simplex& self, float32 x, float32 y, float32 z, float32 w)
+        {
+            float32 s = (x + y + z + w) * k_f4;
+            float32 fi = std::floor(x + s);
+            float32 fj = std::floor(y + s);
+            float32 fk = std::floor(z + s);
+            float32 fl = std::floor(w + s);
+            float32 t = (fi + fj + fk + fl) * k_g4;
+
+            float32 x0 = x - (fi - t);
+            float32 y0 = y - (fj - t);
+            float32 z0 = z - (fk - t);
+            float32 w0 = w - (fl - t);
+
+            // each axis' rank among the four decides the order corners are visited in
+            int rx = 0, ry = 0, rz = 0, rw = 0;
+            if (x0 > y0) ++rx; else ++ry;
+            if (x0 > z0) ++rx; else ++rz;
+            if (x0 > w0) ++rx; else ++rw;
+            if (y0 > z0) ++ry; else ++rz;
+            if (y0 > w0) ++ry; else ++rw;
+            if (z0 > w0) ++rz; else ++rw;
+
+            int i1 = rx >= 3, j1 = ry >= 3, k1 = rz >= 3, l1 = rw >= 3;
+            int i2 = rx >= 2, j2 = ry >= 2, k2 = rz >= 2, l2 = rw >= 2;
+            int i3 = rx >= 1, j3 = ry >= 1, k3 = rz >= 1, l3 = rw >= 1;
+
+            float32 x1 = x0 - i1 + k_g4, y1 = y0 - j1 + k_g4, z1 = z0 - k1 + k_g4, w1 = w0 - l1 + k_g4;
+            float32 x2 = x0 - i2 + 2.0f * k_g4, y2 = y0 - j2 + 2.0f * k_g4, z2 = z0 - k2 + 2.0f * k_g4, w2 = w0 - l2 + 2.0f * k_g4;
+            float32 x3 = x0 - i3 + 3.0f * k_g4, y3 = y0 - j3 + 3.0f * k_g4, z3 = z0 - k3 + 3.0f * k_g4, w3 = w0 - l3 + 3.0f * k_g4;
+            float32 x4 = x0 - 1.0f + 4.0f * k_g4, y4 = y0 - 1.0f + 4.0f * k_g4, z4 = z0 - 1.0f + 4.0f * k_g4, w4 = w0 - 1.0f + 4.0f * k_g4;
+
+            int ii = static_cast<int>(fi) & 255;
+            int jj = static_cast<int>(fj) & 255;
+            int kk = static_cast<int>(fk) & 255;
+            int ll = static_cast<int>(fl) & 255;
+
+            const int32* perm = self.perm;
+            auto hash = [perm, ii, jj, kk, ll](int a, int b, int c, int d)
+            {
+                return perm[ii + a + perm[jj + b + perm[kk + c + perm[ll + d]]]] & 31;
+            };
+
+            float32 n0 = corner4(x0, y0, z0, w0, hash(0, 0, 0, 0));
+            float32 n1 = corner4(x1, y1, z1, w1, hash(i1, j1, k1, l1));
+            float32 n2 = corner4(x2, y2, z2, w2, hash(i2, j2, k2, l2));
+            float32 n3 = corner4(x3, y3, z3, w3, hash(i3, j3, k3, l3));
+            float32 n4 = corner4(x4, y4, z4, w4, hash(1, 1, 1, 1));
+
+            return k_scale4 * (n0 + n1 + n2 + n3 + n4);
+        }
+
+        // avx2, same operations in the same order as the scalar versions above
+
+        TDJX_TARGET_AVX2
+        static inline __m256i gather8(const int32* table, __m256i index)
+        {
+            return _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 4);
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256 falloff8(__m256 t)
+        {
+            // t < 0 contributes nothing, otherwise t^4
+            __m256 keep = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ);
+            t = _mm256_mul_ps(t, t);
+            return _mm256_and_ps(_mm256_mul_ps(t, t), keep);
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256 corner2_8(__m256 x, __m256 y, __m256i g)
+        {
+            __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y));
+            __m256 dot = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad3X, g, 4), x),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad3Y, g, 4), y));
+            return _mm256_mul_ps(falloff8(t), dot);
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256 corner3_8(__m256 x, __m256 y, __m256 z, __m256i g)
+        {
+            __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.6f),
+                _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+            __m256 dot = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad3X, g, 4), x),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad3Y, g, 4), y)),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad3Z, g, 4), z));
+            return _mm256_mul_ps(falloff8(t), dot);
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256 corner4_8(__m256 x, __m256 y, __m256 z, __m256 w, __m256i g)
+        {
+            __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.6f),
+                _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w));
+            __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad4X, g, 4), x),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad4Y, g, 4), y)),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad4Z, g, 4), z)),
+                _mm256_mul_ps(_mm256_i32gather_ps(k_grad4W, g, 4), w));
+            return _mm256_mul_ps(falloff8(t), dot);
+        }
+
+        // 1.0f where a > b, else 0.0f
+        TDJX_TARGET_AVX2
+        static inline __m256 step8(__m256 a, __m256 b, int predicate)
+        {
+            return _mm256_and_ps(_mm256_cmp_ps(a, b, predicate), _mm256_set1_ps(1.0f));
+        }
+
+        TDJX_TARGET_AVX2
+        static size_t simplex2_avx2(const Simplex& self, const float32* xs, const float32* ys, float32* out, size_t n)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 g2 = _mm256_set1_ps(k_g2);
+            const __m256 g2x2 = _mm256_set1_ps(2.0f * k_g2);
+            const __m256i mask = _mm256_set1_epi32(255);
+            const __m256i onei = _mm256_set1_epi32(1);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(xs + i);
+                __m256 y = _mm256_loadu_ps(ys + i);
+
+                __m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(k_f2));
+                __m256 fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+                __m256 fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+                __m256 t = _mm256_mul_ps(_mm256_add_ps(fi, fj), g2);
+
+                __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+                __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+
+                __m256 i1 = step8(x0, y0, _CMP_GT_OQ);
+                __m256 j1 = _mm256_sub_ps(one, i1);
+
+                __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, i1), g2);
+                __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, j1), g2);
+                __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, one), g2x2);
+                __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, one), g2x2);
+
+                __m256i ii = _mm256_and_si256(_mm256_cvttps_epi32(fi), mask);
+                __m256i jj = _mm256_and_si256(_mm256_cvttps_epi32(fj), mask);
+                __m256i oi = _mm256_cvttps_epi32(i1);
+                __m256i oj = _mm256_cvttps_epi32(j1);
+
+                __m256i g0 = gather8(self.permMod12, _mm256_add_epi32(ii, gather8(self.perm, jj)));
+                __m256i g1 = gather8(self.permMod12, _mm256_add_epi32(_mm256_add_epi32(ii, oi), gather8(self.perm, _mm256_add_epi32(jj, oj))));
+                __m256i g2i = gather8(self.permMod12, _mm256_add_epi32(_mm256_add_epi32(ii, onei), gather8(self.perm, _mm256_add_epi32(jj, onei))));
+
+                __m256 sum = _mm256_add_ps(_mm256_add_ps(corner2_8(x0, y0, g0), corner2_8(x1, y1, g1)), corner2_8(x2, y2, g2i));
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_set1_ps(k_scale2), sum));
+            }
+            return i;
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256i hash3_8(const Simplex& self, __m256i ii, __m256i jj, __m256i kk, __m256i a, __m256i b, __m256i c)
+        {
+            __m256i h = gather8(self.perm, _mm256_add_epi32(kk, c));
+            h = gather8(self.perm, _mm256_add_epi32(_mm256_add_epi32(jj, b), h));
+            return gather8(self.permMod12, _mm256_add_epi32(_mm256_add_epi32(ii, a), h));
+        }
+
+        TDJX_TARGET_AVX2
+        static size_t simplex3_avx2(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 g3 = _mm256_set1_ps(k_g3);
+            const __m256 g3x2 = _mm256_set1_ps(2.0f * k_g3);
+            const __m256 g3x3 = _mm256_set1_ps(3.0f * k_g3);
+            const __m256i mask = _mm256_set1_epi32(255);
+            const __m256i zeroi = _mm256_setzero_si256();
+            const __m256i onei = _mm256_set1_epi32(1);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(xs + i);
+                __m256 y = _mm256_loadu_ps(ys + i);
+                __m256 z = _mm256_loadu_ps(zs + i);
+
+                __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(k_f3));
+                __m256 fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+                __m256 fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+                __m256 fk = _mm256_floor_ps(_mm256_add_ps(z, s));
+                __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(fi, fj), fk), g3);
+
+                __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+                __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+                __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(fk, t));
+
+                // same six cases as the scalar ranking, written as comparisons
+                __m256 xy = _mm256_cmp_ps(x0, y0, _CMP_GE_OQ);
+                __m256 yz = _mm256_cmp_ps(y0, z0, _CMP_GE_OQ);
+                __m256 xz = _mm256_cmp_ps(x0, z0, _CMP_GE_OQ);
+                __m256 onef = one;
+
+                // i1 = x is largest, j1 = y is largest, k1 = z is largest
+                __m256 i1 = _mm256_and_ps(_mm256_and_ps(xy, xz), onef);
+                __m256 j1 = _mm256_and_ps(_mm256_andnot_ps(xy, yz), onef);
+                __m256 k1 = _mm256_sub_ps(_mm256_sub_ps(onef, i1), j1);
+                // i2 = x isn't smallest, j2 = y isn't smallest, k2 = z isn't smallest
+                __m256 i2 = _mm256_and_ps(_mm256_or_ps(xy, xz), onef);
+                __m256 j2 = _mm256_and_ps(_mm256_or_ps(_mm256_andnot_ps(xy, onef), _mm256_and_ps(yz, onef)), onef);
+                __m256 k2 = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(2.0f), i2), j2);
+
+                __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, i1), g3);
+                __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, j1), g3);
+                __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, k1), g3);
+                __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, i2), g3x2);
+                __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, j2), g3x2);
+                __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, k2), g3x2);
+                __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, one), g3x3);
+                __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, one), g3x3);
+                __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, one), g3x3);
+
+                __m256i ii = _mm256_and_si256(_mm256_cvttps_epi32(fi), mask);
+                __m256i jj = _mm256_and_si256(_mm256_cvttps_epi32(fj), mask);
+                __m256i kk = _mm256_and_si256(_mm256_cvttps_epi32(fk), mask);
+
+                __m256i h0 = hash3_8(self, ii, jj, kk, zeroi, zeroi, zeroi);
+                __m256i h1 = hash3_8(self, ii, jj, kk, _mm256_cvttps_epi32(i1), _mm256_cvttps_epi32(j1), _mm256_cvttps_epi32(k1));
+                __m256i h2 = hash3_8(self, ii, jj, kk, _mm256_cvttps_epi32(i2), _mm256_cvttps_epi32(j2), _mm256_cvttps_epi32(k2));
+                __m256i h3 = hash3_8(self, ii, jj, kk, onei, onei, onei);
+
+                __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                    corner3_8(x0, y0, z0, h0), corner3_8(x1, y1, z1, h1)),
+                    corner3_8(x2, y2, z2, h2)), corner3_8(x3, y3, z3, h3));
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_set1_ps(k_scale3), sum));
+            }
+            return i;
+        }
+
+        TDJX_TARGET_AVX2
+        static inline __m256i hash4_8(const Simplex& self, __m256i ii, __m256i jj, __m256i kk, __m256i ll, __m256i a, __m256i b, __m256i c, __m256i d)
+        {
+            __m256i h = gather8(self.perm, _mm256_add_epi32(ll, d));
+            h = gather8(self.perm, _mm256_add_epi32(_mm256_add_epi32(kk, c), h));
+            h = gather8(self.perm, _mm256_add_epi32(_mm256_add_epi32(jj, b), h));
+            h = gather8(self.perm, _mm256_add_epi32(_mm256_add_epi32(ii, a), h));
+            return _mm256_and_si256(h, _mm256_set1_epi32(31));
+        }
+
+        // 1 where rank >= threshold
+        TDJX_TARGET_AVX2
+        static inline __m256i rank_at_least(__m256i rank, int threshold)
+        {
+            return _mm256_and_si256(_mm256_cmpgt_epi32(rank, _mm256_set1_epi32(threshold - 1)), _mm256_set1_epi32(1));
+        }
+
+        TDJX_TARGET_AVX2
+        static size_t simplex4_avx2(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, const float32* ws, float32* out, size_t n)
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256i mask = _mm256_set1_epi32(255);
+            const __m256i zeroi = _mm256_setzero_si256();
+            const __m256i onei = _mm256_set1_epi32(1);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(xs + i);
+                __m256 y = _mm256_loadu_ps(ys + i);
+                __m256 z = _mm256_loadu_ps(zs + i);
+                __m256 w = _mm256_loadu_ps(ws + i);
+
+                __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), w), _mm256_set1_ps(k_f4));
+                __m256 fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+                __m256 fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+                __m256 fk = _mm256_floor_ps(_mm256_add_ps(z, s));
+                __m256 fl = _mm256_floor_ps(_mm256_add_ps(w, s));
+                __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(fi, fj), fk), fl), _mm256_set1_ps(k_g4));
+
+                __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+                __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+                __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(fk, t));
+                __m256 w0 = _mm256_sub_ps(w, _mm256_sub_ps(fl, t));
+
+                // compare masks are -1 where true, so subtracting them counts wins
+                __m256i xy = _mm256_castps_si256(_mm256_cmp_ps(x0, y0, _CMP_GT_OQ));
+                __m256i xz = _mm256_castps_si256(_mm256_cmp_ps(x0, z0, _CMP_GT_OQ));
+                __m256i xw = _mm256_castps_si256(_mm256_cmp_ps(x0, w0, _CMP_GT_OQ));
+                __m256i yz = _mm256_castps_si256(_mm256_cmp_ps(y0, z0, _CMP_GT_OQ));
+                __m256i yw = _mm256_castps_si256(_mm256_cmp_ps(y0, w0, _CMP_GT_OQ));
+                __m256i zw = _mm256_castps_si256(_mm256_cmp_ps(z0, w0, _CMP_GT_OQ));
+                __m256i all = _mm256_set1_epi32(-1);
+
+                __m256i rx = _mm256_sub_epi32(zeroi, _mm256_add_epi32(_mm256_add_epi32(xy, xz), xw));
+                __m256i ry = _mm256_sub_epi32(zeroi, _mm256_add_epi32(_mm256_add_epi32(_mm256_xor_si256(xy, all), yz), yw));
+                __m256i rz = _mm256_sub_epi32(zeroi, _mm256_add_epi32(_mm256_add_epi32(_mm256_xor_si256(xz, all), _mm256_xor_si256(yz, all)), zw));
+                __m256i rw = _mm256_sub_epi32(zeroi, _mm256_add_epi32(_mm256_add_epi32(_mm256_xor_si256(xw, all), _mm256_xor_si256(yw, all)), _mm256_xor_si256(zw, all)));
+
+                __m256i o[3][4];
+                for (int c = 0; c < 3; ++c)
+                {
+                    o[c][0] = rank_at_least(rx, 3 - c);
+                    o[c][1] = rank_at_least(ry, 3 - c);
+                    o[c][2] = rank_at_least(rz, 3 - c);
+                    o[c][3] = rank_at_least(rw, 3 - c);
+                }
+
+                __m256i ii = _mm256_and_si256(_mm256_cvttps_epi32(fi), mask);
+                __m256i jj = _mm256_and_si256(_mm256_cvttps_epi32(fj), mask);
+                __m256i kk = _mm256_and_si256(_mm256_cvttps_epi32(fk), mask);
+                __m256i ll = _mm256_and_si256(_mm256_cvttps_epi32(fl), mask);
+
+                __m256 sum = corner4_8(x0, y0, z0, w0, hash4_8(self, ii, jj, kk, ll, zeroi, zeroi, zeroi, zeroi));
+                for (int c = 0; c < 3; ++c)
+                {
+                    __m256 g = _mm256_set1_ps((c + 1) * k_g4);
+                    __m256 xc = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(o[c][0])), g);
+                    __m256 yc = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(o[c][1])), g);
+                    __m256 zc = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(o[c][2])), g);
+                    __m256 wc = _mm256_add_ps(_mm256_sub_ps(w0, _mm256_cvtepi32_ps(o[c][3])), g);
+                    sum = _mm256_add_ps(sum, corner4_8(xc, yc, zc, wc, hash4_8(self, ii, jj, kk, ll, o[c][0], o[c][1], o[c][2], o[c][3])));
+                }
+
+                __m256 g4x4 = _mm256_set1_ps(4.0f * k_g4);
+                __m256 x4 = _mm256_add_ps(_mm256_sub_ps(x0, one), g4x4);
+                __m256 y4 = _mm256_add_ps(_mm256_sub_ps(y0, one), g4x4);
+                __m256 z4 = _mm256_add_ps(_mm256_sub_ps(z0, one), g4x4);
+                __m256 w4 = _mm256_add_ps(_mm256_sub_ps(w0, one), g4x4);
+                sum = _mm256_add_ps(sum, corner4_8(x4, y4, z4, w4, hash4_8(self, ii, jj, kk, ll, onei, onei, onei, onei)));
+
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_set1_ps(k_scale4), sum));
+            }
+            return i;
+        }
+
+        void simplex2_batch(const Simplex& self, const float32* xs, const float32* ys, float32* out, size_t n)
+        {
+            size_t done = util::cpu_has_avx2() ? simplex2_avx2(self, xs, ys, out, n) : 0;
+            for (size_t i = done; i < n; ++i)
+            {
+                out[i] = simplex2(self, xs[i], ys[i]);
+            }
+        }
+
+        void simplex3_batch(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n)
+        {
+            size_t done = util::cpu_has_avx2() ? simplex3_avx2(self, xs, ys, zs, out, n) : 0;
+            for (size_t i = done; i < n; ++i)
+            {
+                out[i] = simplex3(self, xs[i], ys[i], zs[i]);
+            }
+        }
+
+        void simplex4_batch(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, const float32* ws, float32* out, size_t n)
+        {
+            size_t done = util::cpu_has_avx2() ? simplex4_avx2(self, xs, ys, zs, ws, out, n) : 0;
+            for (size_t i = done; i < n; ++i)
+            {
+                out[i] = simplex4(self, xs[i], ys[i], zs[i], ws[i]);
+            }
+        }
+
+        // fractals. the batch forms work through the points in chunks small enough to keep on the stack,
+        // scaling each chunk's coordinates per octave and handing them to the simplex batch functions
+
+        const size_t k_chunkSize = 256;
+
+        inline float32 ridge(float32 n, float32& weight)
+        {
+            float32 signal = 1.0f - std::abs(n);
+            signal *= signal;
+            signal *= weight;
+            weight = signal;
+            return signal;
+        }
+
+        float32 fbm2(const Simplex& self, const Fractal& fractal, float32 x, float32 y)
+        {
+            float32 sum = 0.0f, norm = 0.0f, amplitude = 1.0f, frequency = fractal.frequency;
+            for (int o = 0; o < fractal.octaves; ++o)
+            {
+                sum += simplex2(self, x * frequency, y * frequency) * amplitude;
+                norm += amplitude;
+                amplitude *= fractal.gain;
+                frequency *= fractal.lacunarity;
+            }
+            return sum / norm;
+        }
+
+        float32 fbm3(const Simplex& self, const Fractal& fractal, float32 x, float32 y, float32 z)
+        {
+            float32 sum = 0.0f, norm = 0.0f, amplitude = 1.0f, frequency = fractal.frequency;
+            for (int o = 0; o < fractal.octaves; ++o)
+            {
+                sum += simplex3(self, x * frequency, y * frequency, z * frequency) * amplitude;
+                norm += amplitude;
+                amplitude *= fractal.gain;
+                frequency *= fractal.lacunarity;
+            }
+            return sum / norm;
+        }
+
+        float32 ridged2(const Simplex& self, const Fractal& fractal, float32 x, float32 y)
+        {
+            float32 sum = 0.0f, norm = 0.0f, amplitude = 1.0f, frequency = fractal.frequency, weight = 1.0f;
+            for (int o = 0; o < fractal.octaves; ++o)
+            {
+                sum += ridge(simplex2(self, x * frequency, y * frequency), weight) * amplitude;
+                norm += amplitude;
+                amplitude *= fractal.gain;
+                frequency *= fractal.lacunarity;
+            }
+            return sum / norm * 2.0f - 1.0f;
+        }
+
+        float32 ridged3(const Simplex& self, const Fractal& fractal, float32 x, float32 y, float32 z)
+        {
+            float32 sum = 0.0f, norm = 0.0f, amplitude = 1.0f, frequency = fractal.frequency, weight = 1.0f;
+            for (int o = 0; o < fractal.octaves; ++o)
+            {
+                sum += ridge(simplex3(self, x * frequency, y * frequency, z * frequency), weight) * amplitude;
+                norm += amplitude;
+                amplitude *= fractal.gain;
+                frequency *= fractal.lacunarity;
+            }
+            return sum / norm * 2.0f - 1.0f;
+        }
+
+        void fractal_batch(const Simplex& self, const Fractal& fractal, bool ridged, int dims,
+            const float32* const* coords, float32* out, size_t n)
+        {
+            float32 scaled[3][k_chunkSize];
+            float32 value[k_chunkSize];
+            float32 sum[k_chunkSize];
+            float32 weight[k_chunkSize];
+
+            for (size_t base = 0; base < n; base += k_chunkSize)
+            {
+                size_t count = std::min(k_chunkSize, n - base);
+
+                std::fill(sum, sum + count, 0.0f);
+                std::fill(weight, weight + count, 1.0f);
+
+                float32 norm = 0.0f, amplitude = 1.0f, frequency = fractal.frequency;
+                for (int o = 0; o < fractal.octaves; ++o)
+                {
+                    for (int d = 0; d < dims; ++d)
+                    {
+                        const float32* src = coords[d] + base;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            scaled[d][i] = src[i] * frequency;
+                        }
+                    }
+
+                    if (dims == 2)
+                    {
+                        simplex2_batch(self, scaled[0], scaled[1], value, count);
+                    }
+                    else
+                    {
+                        simplex3_batch(self, scaled[0], scaled[1], scaled[2], value, count);
+                    }
+
+                    if (ridged)
+                    {
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            sum[i] += ridge(value[i], weight[i]) * amplitude;
+                        }
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            sum[i] += value[i] * amplitude;
+                        }
+                    }
+
+                    norm += amplitude;
+                    amplitude *= fractal.gain;
+                    frequency *= fractal.lacunarity;
+                }
+
+                float32* dest = out + base;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dest[i] = ridged ? sum[i] / norm * 2.0f - 1.0f : sum[i] / norm;
+                }
+            }
+        }
+
+        void fbm2_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys };
+            fractal_batch(self, fractal, false, 2, coords, out, n);
+        }
+
+        void fbm3_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys, zs };
+            fractal_batch(self, fractal, false, 3, coords, out, n);
+        }
+
+        void ridged2_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys };
+            fractal_batch(self, fractal, true, 2, coords, out, n);
+        }
+
+        void ridged3_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys, zs };
+            fractal_batch(self, fractal, true, 3, coords, out, n);
+        }
+
+        // arbitrary offsets so the warp fields don't line up with each other or the base field
+        const float32 k_warpOffsets[3][3] = {
+            { 0.0f, 0.0f, 0.0f },
+            { 5.2f, 1.3f, 2.8f },
+            { 1.7f, 9.2f, 4.1f },
+        };
+
+        float32 warp2(const Simplex& self, const Warp& warp, float32 x, float32 y)
+        {
+            float32 qx = fbm2(self, warp.fractal, x + k_warpOffsets[0][0], y + k_warpOffsets[0][1]);
+            float32 qy = fbm2(self, warp.fractal, x + k_warpOffsets[1][0], y + k_warpOffsets[1][1]);
+            return fbm2(self, warp.fractal, x + warp.amplitude * qx, y + warp.amplitude * qy);
+        }
+
+        float32 warp3(const Simplex& self, const Warp& warp, float32 x, float32 y, float32 z)
+        {
+            float32 q[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                q[i] = fbm3(self, warp.fractal, x + k_warpOffsets[i][0], y + k_warpOffsets[i][1], z + k_warpOffsets[i][2]);
+            }
+            return fbm3(self, warp.fractal, x + warp.amplitude * q[0], y + warp.amplitude * q[1], z + warp.amplitude * q[2]);
+        }
+
+        void warp_batch(const Simplex& self, const Warp& warp, int dims, const float32* const* coords, float32* out, size_t n)
+        {
+            float32 shifted[3][k_chunkSize];
+            float32 q[3][k_chunkSize];
+
+            for (size_t base = 0; base < n; base += k_chunkSize)
+            {
+                size_t count = std::min(k_chunkSize, n - base);
+                const float32* shiftedCoords[] = { shifted[0], shifted[1], shifted[2] };
+
+                for (int field = 0; field < dims; ++field)
+                {
+                    for (int d = 0; d < dims; ++d)
+                    {
+                        const float32* src = coords[d] + base;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            shifted[d][i] = src[i] + k_warpOffsets[field][d];
+                        }
+                    }
+                    fractal_batch(self, warp.fractal, false, dims, shiftedCoords, q[field], count);
+                }
+
+                for (int d = 0; d < dims; ++d)
+                {
+                    const float32* src = coords[d] + base;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        shifted[d][i] = src[i] + warp.amplitude * q[d][i];
+                    }
+                }
+                fractal_batch(self, warp.fractal, false, dims, shiftedCoords, out + base, count);
+            }
+        }
+
+        void warp2_batch(const Simplex& self, const Warp& warp, const float32* xs, const float32* ys, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys };
+            warp_batch(self, warp, 2, coords, out, n);
+        }
+
+        void warp3_batch(const Simplex& self, const Warp& warp, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n)
+        {
+            const float32* coords[] = { xs, ys, zs };
+            warp_batch(self, warp, 3, coords, out, n);
+        }
+
+        // benchmark
+
+        void run_benchmark(const perlin_gen& perlin, std::vector<BenchmarkResult>& out)
+        {
+            const size_t k_samples = 1 << 16;
+            const int k_repeats = 5;
+
+            std::vector<float32> xs(k_samples), ys(k_samples), zs(k_samples), ws(k_samples), values(k_samples);
+            std::default_random_engine engine(1234);
+            std::uniform_real_distribution<float32> range(-64.0f, 64.0f);
+            for (size_t i = 0; i < k_samples; ++i)
+            {
+                xs[i] = range(engine);
+                ys[i] = range(engine);
+                zs[i] = range(engine);
+                ws[i] = range(engine);
+            }
+
+            Simplex simplex;
+            seed(simplex, 1234);
+
+            Fractal fractal;
+            Warp warp;
+
+            // best of a few runs, the sink keeps the scalar loops from being thrown away
+            volatile float32 sink = 0.0f;
+            auto time = [&](const char* name, auto&& fn)
+            {
+                float64 best = 1e30;
+                for (int r = 0; r < k_repeats; ++r)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    fn();
+                    auto end = std::chrono::steady_clock::now();
+                    best = std::min(best, std::chrono::duration<float64, std::nano>(end - start).count());
+                    sink = sink + values[r];
+                }
+                out.push_back({ name, best / k_samples });
+            };
+
+            out.clear();
+
+            time("perlin 3d", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i) values[i] = perlin.noise(xs[i], ys[i], zs[i]);
+            });
+            time("perlin 3d batch", [&]()
+            {
+                perlin.noise_batch(xs.data(), ys.data(), zs.data(), values.data(), k_samples);
+            });
+            time("perlin 3d x5 octaves", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i)
+                {
+                    float32 sum = 0.0f, amplitude = 1.0f, frequency = 1.0f;
+                    for (int o = 0; o < 5; ++o, amplitude *= 0.5f, frequency *= 2.0f)
+                    {
+                        sum += perlin.noise(xs[i] * frequency, ys[i] * frequency, zs[i] * frequency) * amplitude;
+                    }
+                    values[i] = sum;
+                }
+            });
+            time("simplex 2d", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i) values[i] = simplex2(simplex, xs[i], ys[i]);
+            });
+            time("simplex 2d batch", [&]()
+            {
+                simplex2_batch(simplex, xs.data(), ys.data(), values.data(), k_samples);
+            });
+            time("simplex 3d", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i) values[i] = simplex3(simplex, xs[i], ys[i], zs[i]);
+            });
+            time("simplex 3d batch", [&]()
+            {
+                simplex3_batch(simplex, xs.data(), ys.data(), zs.data(), values.data(), k_samples);
+            });
+            time("simplex 4d", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i) values[i] = simplex4(simplex, xs[i], ys[i], zs[i], ws[i]);
+            });
+            time("simplex 4d batch", [&]()
+            {
+                simplex4_batch(simplex, xs.data(), ys.data(), zs.data(), ws.data(), values.data(), k_samples);
+            });
+            time("fbm 2d x5 batch", [&]()
+            {
+                fbm2_batch(simplex, fractal, xs.data(), ys.data(), values.data(), k_samples);
+            });
+            time("fbm 3d x5", [&]()
+            {
+                for (size_t i = 0; i < k_samples; ++i) values[i] = fbm3(simplex, fractal, xs[i], ys[i], zs[i]);
+            });
+            time("fbm 3d x5 batch", [&]()
+            {
+                fbm3_batch(simplex, fractal, xs.data(), ys.data(), zs.data(), values.data(), k_samples);
+            });
+            time("ridged 3d x5 batch", [&]()
+            {
+                ridged3_batch(simplex, fractal, xs.data(), ys.data(), zs.data(), values.data(), k_samples);
+            });
+            time("warp 2d x5 batch", [&]()
+            {
+                warp2_batch(simplex, warp, xs.data(), ys.data(), values.data(), k_samples);
+            });
+        }
+
+        void draw_benchmark_ui()
+        {
+            static std::vector<BenchmarkResult> s_results;
+
+            if (!ImGui::CollapsingHeader("Noise Benchmark"))
+            {
+                return;
+            }
+
+            if (ImGui::Button("Run"))
+            {
+                perlin_gen perlin(0);
+                run_benchmark(perlin, s_results);
+            }
+
+            ImGui::SameLine();
+            ImGui::Text("%s", util::cpu_has_avx2() ? "avx2" : "scalar");
+
+            if (s_results.empty())
+            {
+                return;
+            }
+
+            // everything relative to a single scalar perlin sample
+            float64 baseline = s_results[0].nsPerSample;
+            for (const BenchmarkResult& result : s_results)
+            {
+                ImGui::Text("%-22s %8.2f ns  %5.2fx", result.name, result.nsPerSample, baseline / result.nsPerSample);
+            }
+        }
+    }
+}
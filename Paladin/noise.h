@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+class perlin_gen;
+
+// simplex noise in 2, 3 and 4 dimensions plus fractal sums built on top of it (fbm, ridged, domain warp).
+// every function has a batch form that runs 8 points at a time with avx2 and falls back to the scalar
+// version a point at a time without it. raw simplex values are in [-1..1] unlike perlin_gen's [0..1].
+
+namespace tdjx
+{
+    namespace noise
+    {
+        struct Simplex
+        {
+            // doubled so corner lookups never wrap, padded so the last gathers stay inside the table
+            int32 perm[512 + 8];
+            int32 permMod12[512 + 8];
+        };
+
+        void seed(Simplex& self, uint32 seed);
+
+        float32 simplex2(const Simplex& self, float32 x, float32 y);
+        float32 simplex3(const Simplex& self, float32 x, float32 y, float32 z);
+        float32 simplex4(const Simplex& self, float32 x, float32 y, float32 z, float32 w);
+
+        void simplex2_batch(const Simplex& self, const float32* xs, const float32* ys, float32* out, size_t n);
+        void simplex3_batch(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n);
+        void simplex4_batch(const Simplex& self, const float32* xs, const float32* ys, const float32* zs, const float32* ws, float32* out, size_t n);
+
+        struct Fractal
+        {
+            int octaves = 5;
+            float32 frequency = 1.0f;
+            float32 lacunarity = 2.0f;
+            float32 gain = 0.5f;
+        };
+
+        // sum of octaves normalized back to [-1..1]
+        float32 fbm2(const Simplex& self, const Fractal& fractal, float32 x, float32 y);
+        float32 fbm3(const Simplex& self, const Fractal& fractal, float32 x, float32 y, float32 z);
+
+        // sharp creases where the noise crosses 0, each octave weighted by the one before it, in [-1..1]
+        float32 ridged2(const Simplex& self, const Fractal& fractal, float32 x, float32 y);
+        float32 ridged3(const Simplex& self, const Fractal& fractal, float32 x, float32 y, float32 z);
+
+        void fbm2_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, float32* out, size_t n);
+        void fbm3_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n);
+        void ridged2_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, float32* out, size_t n);
+        void ridged3_batch(const Simplex& self, const Fractal& fractal, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n);
+
+        // fbm sampled at a point pushed around by two (or three) more fbm fields
+        struct Warp
+        {
+            Fractal fractal;
+            float32 amplitude = 4.0f;
+        };
+
+        float32 warp2(const Simplex& self, const Warp& warp, float32 x, float32 y);
+        float32 warp3(const Simplex& self, const Warp& warp, float32 x, float32 y, float32 z);
+
+        void warp2_batch(const Simplex& self, const Warp& warp, const float32* xs, const float32* ys, float32* out, size_t n);
+        void warp3_batch(const Simplex& self, const Warp& warp, const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n);
+
+        struct BenchmarkResult
+        {
+            const char* name;
+            float64 nsPerSample;
+        };
+
+        // times every variant against perlin_gen over the same points
+        void run_benchmark(const perlin_gen& perlin, std::vector<BenchmarkResult>& out);
+
+        // run button and results table, drawn into whatever imgui window is current
+        void draw_benchmark_ui();
+    }
+}
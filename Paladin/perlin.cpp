@@ -1,6 +1,7 @@
 #include "perlin.h"
 
 #include "algebra.h"
+#include "tdjx_simd.h"
 
 using math::lerp;
 using math::grad;
@@ -10,6 +11,7 @@ perlin_gen::perlin_gen(uint32 seed) {
     std::default_random_engine engine(seed);
     std::shuffle(&d[0], &d[256], engine);
     std::copy(&d[0], &d[256], &d[256]);
+    std::fill(&d[512], &d[516], 0);
 }
 
 float32 perlin_gen::noise(float32 x, float32 y, float32 z /* = 0.f */) const {
@@ -54,4 +56,346 @@ float32 perlin_gen::noise(float32 x, float32 y, float32 z /* = 0.f */) const {
         w);
 
     return (ret + 1.f) / 2.f;
+}
+
+// batch noise. hashes come from 32 bit gathers into the permutation table (masked down to the byte),
+// everything else is the scalar noise() above done a lane at a time in the same order
+
+TDJX_TARGET_AVX2
+static inline __m256i perm8(const uint8* d, __m256i index) {
+    __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(d), index, 1);
+    return _mm256_and_si256(v, _mm256_set1_epi32(0xFF));
+}
+
+TDJX_TARGET_AVX2
+static inline __m256 fade8(__m256 t) {
+    // t * t * t * (t * (t * 6 - 15) + 10)
+    __m256 inner = _mm256_add_ps(
+        _mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f))),
+        _mm256_set1_ps(10.f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+TDJX_TARGET_AVX2
+static inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+
+TDJX_TARGET_AVX2
+static inline __m256 grad8(__m256i hash, __m256 x, __m256 y, __m256 z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+
+    __m256 hLess8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 hLess4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 h12or14 = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+
+    __m256 u = _mm256_blendv_ps(y, x, hLess8);
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, h12or14), y, hLess4);
+
+    // bits 0 and 1 of the hash flip the signs of u and v
+    __m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+    __m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31));
+
+    return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+}
+
+TDJX_TARGET_AVX2
+static void noise8(const uint8* d, __m256 x, __m256 y, __m256 z, float32* out) {
+    const __m256i mask = _mm256_set1_epi32(255);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 onef = _mm256_set1_ps(1.f);
+
+    __m256 fx = _mm256_floor_ps(x);
+    __m256 fy = _mm256_floor_ps(y);
+    __m256 fz = _mm256_floor_ps(z);
+
+    __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+    __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+    __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+
+    x = _mm256_sub_ps(x, fx);
+    y = _mm256_sub_ps(y, fy);
+    z = _mm256_sub_ps(z, fz);
+
+    __m256 u = fade8(x), v = fade8(y), w = fade8(z);
+
+    __m256i A = _mm256_add_epi32(perm8(d, X), Y);
+    __m256i AA = _mm256_add_epi32(perm8(d, A), Z);
+    __m256i AB = _mm256_add_epi32(perm8(d, _mm256_add_epi32(A, one)), Z);
+    __m256i B = _mm256_add_epi32(perm8(d, _mm256_add_epi32(X, one)), Y);
+    __m256i BA = _mm256_add_epi32(perm8(d, B), Z);
+    __m256i BB = _mm256_add_epi32(perm8(d, _mm256_add_epi32(B, one)), Z);
+
+    __m256 x1 = _mm256_sub_ps(x, onef);
+    __m256 y1 = _mm256_sub_ps(y, onef);
+    __m256 z1 = _mm256_sub_ps(z, onef);
+
+    __m256 ret = lerp8(
+        lerp8(
+            lerp8(
+                grad8(perm8(d, AA), x, y, z),
+                grad8(perm8(d, BA), x1, y, z),
+                u),
+            lerp8(
+                grad8(perm8(d, AB), x, y1, z),
+                grad8(perm8(d, BB), x1, y1, z),
+                u),
+            v),
+        lerp8(
+            lerp8(
+                grad8(perm8(d, _mm256_add_epi32(AA, one)), x, y, z1),
+                grad8(perm8(d, _mm256_add_epi32(BA, one)), x1, y, z1),
+                u),
+            lerp8(
+                grad8(perm8(d, _mm256_add_epi32(AB, one)), x, y1, z1),
+                grad8(perm8(d, _mm256_add_epi32(BB, one)), x1, y1, z1),
+                u),
+            v),
+        w);
+
+    // (ret + 1) / 2, halving is exact so the multiply matches the divide
+    _mm256_storeu_ps(out, _mm256_mul_ps(_mm256_add_ps(ret, onef), _mm256_set1_ps(0.5f)));
+}
+
+TDJX_TARGET_AVX2
+static size_t noise_batch_avx2(const uint8* d, const float32* xs, const float32* ys, const float32* zs, float32 z, float32* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vz = (zs != nullptr) ? _mm256_loadu_ps(zs + i) : _mm256_set1_ps(z);
+        noise8(d, _mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), vz, out + i);
+    }
+    return i;
+}
+
+// sse2 has no gathers or floor, hashes are looked up a lane at a time and floor is rebuilt from truncation
+static inline __m128 floor4(__m128 v) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.f)));
+}
+
+static inline __m128 fade4(__m128 t) {
+    __m128 inner = _mm_add_ps(
+        _mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))),
+        _mm_set1_ps(10.f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+static inline __m128 grad4(const int* hash, __m128 x, __m128 y, __m128 z) {
+    alignas(16) float32 xs[4], ys[4], zs[4], out[4];
+    _mm_store_ps(xs, x);
+    _mm_store_ps(ys, y);
+    _mm_store_ps(zs, z);
+    for (int i = 0; i < 4; ++i) {
+        out[i] = grad(hash[i], xs[i], ys[i], zs[i]);
+    }
+    return _mm_load_ps(out);
+}
+
+static void noise4(const uint8* d, __m128 x, __m128 y, __m128 z, float32* out) {
+    const __m128 onef = _mm_set1_ps(1.f);
+
+    __m128 fx = floor4(x);
+    __m128 fy = floor4(y);
+    __m128 fz = floor4(z);
+
+    alignas(16) int X[4], Y[4], Z[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(X), _mm_cvttps_epi32(fx));
+    _mm_store_si128(reinterpret_cast<__m128i*>(Y), _mm_cvttps_epi32(fy));
+    _mm_store_si128(reinterpret_cast<__m128i*>(Z), _mm_cvttps_epi32(fz));
+
+    // corner hashes in the same order noise() uses them
+    alignas(16) int h[8][4];
+    for (int i = 0; i < 4; ++i) {
+        int xi = X[i] & 255, yi = Y[i] & 255, zi = Z[i] & 255;
+        int A = d[xi] + yi;
+        int AA = d[A] + zi;
+        int AB = d[A + 1] + zi;
+        int B = d[xi + 1] + yi;
+        int BA = d[B] + zi;
+        int BB = d[B + 1] + zi;
+        h[0][i] = d[AA]; h[1][i] = d[BA]; h[2][i] = d[AB]; h[3][i] = d[BB];
+        h[4][i] = d[AA + 1]; h[5][i] = d[BA + 1]; h[6][i] = d[AB + 1]; h[7][i] = d[BB + 1];
+    }
+
+    x = _mm_sub_ps(x, fx);
+    y = _mm_sub_ps(y, fy);
+    z = _mm_sub_ps(z, fz);
+
+    __m128 u = fade4(x), v = fade4(y), w = fade4(z);
+    __m128 x1 = _mm_sub_ps(x, onef);
+    __m128 y1 = _mm_sub_ps(y, onef);
+    __m128 z1 = _mm_sub_ps(z, onef);
+
+    __m128 ret = lerp4(
+        lerp4(
+            lerp4(grad4(h[0], x, y, z), grad4(h[1], x1, y, z), u),
+            lerp4(grad4(h[2], x, y1, z), grad4(h[3], x1, y1, z), u),
+            v),
+        lerp4(
+            lerp4(grad4(h[4], x, y, z1), grad4(h[5], x1, y, z1), u),
+            lerp4(grad4(h[6], x, y1, z1), grad4(h[7], x1, y1, z1), u),
+            v),
+        w);
+
+    _mm_storeu_ps(out, _mm_mul_ps(_mm_add_ps(ret, onef), _mm_set1_ps(0.5f)));
+}
+
+static size_t noise_batch_sse2(const uint8* d, const float32* xs, const float32* ys, const float32* zs, float32 z, float32* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 vz = (zs != nullptr) ? _mm_loadu_ps(zs + i) : _mm_set1_ps(z);
+        noise4(d, _mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), vz, out + i);
+    }
+    return i;
+}
+
+void perlin_gen::noise_batch(const float32* xs, const float32* ys, float32 z, float32* out, size_t n) const {
+    size_t done = tdjx::util::cpu_has_avx2()
+        ? noise_batch_avx2(d, xs, ys, nullptr, z, out, n)
+        : noise_batch_sse2(d, xs, ys, nullptr, z, out, n);
+
+    for (size_t i = done; i < n; ++i) {
+        out[i] = noise(xs[i], ys[i], z);
+    }
+}
+
+void perlin_gen::noise_batch(const float32* xs, const float32* ys, const float32* zs, float32* out, size_t n) const {
+    size_t done = tdjx::util::cpu_has_avx2()
+        ? noise_batch_avx2(d, xs, ys, zs, 0.f, out, n)
+        : noise_batch_sse2(d, xs, ys, zs, 0.f, out, n);
+
+    for (size_t i = done; i < n; ++i) {
+        out[i] = noise(xs[i], ys[i], zs[i]);
+    }
+}
+
+// gradient at one corner of a lattice cell along a row, x is the only thing that still varies so it
+// comes down to sx * x + c with sx one of -1, 0, 1. adding the x term last is exact because the scalar
+// grad() only ever adds two terms and float addition commutes
+struct cell_corner {
+    float32 sx;
+    float32 c;
+};
+
+static inline cell_corner make_corner(int hash, float32 y, float32 z) {
+    int h = hash & 15;
+    cell_corner corner;
+
+    if (h < 8) {
+        // u is x, v is y or z
+        float32 v = (h < 4) ? y : z;
+        corner.sx = ((h & 1) == 0) ? 1.f : -1.f;
+        corner.c = ((h & 2) == 0) ? v : -v;
+    }
+    else if (h == 12 || h == 14) {
+        // u is y, v is x
+        corner.sx = ((h & 2) == 0) ? 1.f : -1.f;
+        corner.c = ((h & 1) == 0) ? y : -y;
+    }
+    else {
+        // u is y, v is z, nothing left that depends on x
+        corner.sx = 0.f;
+        corner.c = (((h & 1) == 0) ? y : -y) + (((h & 2) == 0) ? z : -z);
+    }
+
+    return corner;
+}
+
+template <typename t_writer>
+void perlin_gen::fill_grid_rows(float32 x0, float32 y0, float32 dx, float32 dy, int w, int h, float32 z, t_writer&& write) const {
+    // everything that only depends on the column
+    static thread_local std::vector<int> colX;
+    static thread_local std::vector<float32> colFrac, colFade;
+    colX.resize(w);
+    colFrac.resize(w);
+    colFade.resize(w);
+
+    for (int i = 0; i < w; ++i) {
+        float32 x = x0 + i * dx;
+        colX[i] = math::floor_int(x) & 255;
+        colFrac[i] = x - math::floor(x);
+        colFade[i] = math::fade(colFrac[i]);
+    }
+
+    int Z = (math::floor_int(z) & 255);
+    float32 zf = z - math::floor(z);
+    float32 w_ = math::fade(zf);
+    float32 zf1 = zf - 1;
+
+    static thread_local std::vector<float32> row;
+    row.resize(w);
+
+    for (int j = 0; j < h; ++j) {
+        float32 y = y0 + j * dy;
+        int Y = (math::floor_int(y) & 255);
+        float32 yf = y - math::floor(y);
+        float32 v = math::fade(yf);
+        float32 yf1 = yf - 1;
+
+        int cellX = -1;
+        cell_corner g[8] = {};
+
+        for (int i = 0; i < w; ++i) {
+            if (colX[i] != cellX) {
+                cellX = colX[i];
+
+                int A = d[cellX] + Y;
+                int AA = d[A] + Z;
+                int AB = d[A + 1] + Z;
+                int B = d[cellX + 1] + Y;
+                int BA = d[B] + Z;
+                int BB = d[B + 1] + Z;
+
+                g[0] = make_corner(d[AA], yf, zf);
+                g[1] = make_corner(d[BA], yf, zf);
+                g[2] = make_corner(d[AB], yf1, zf);
+                g[3] = make_corner(d[BB], yf1, zf);
+                g[4] = make_corner(d[AA + 1], yf, zf1);
+                g[5] = make_corner(d[BA + 1], yf, zf1);
+                g[6] = make_corner(d[AB + 1], yf1, zf1);
+                g[7] = make_corner(d[BB + 1], yf1, zf1);
+            }
+
+            float32 x = colFrac[i];
+            float32 x1 = x - 1;
+            float32 u = colFade[i];
+
+            float32 ret = lerp(
+                lerp(
+                    lerp(g[0].sx * x + g[0].c, g[1].sx * x1 + g[1].c, u),
+                    lerp(g[2].sx * x + g[2].c, g[3].sx * x1 + g[3].c, u),
+                    v),
+                lerp(
+                    lerp(g[4].sx * x + g[4].c, g[5].sx * x1 + g[5].c, u),
+                    lerp(g[6].sx * x + g[6].c, g[7].sx * x1 + g[7].c, u),
+                    v),
+                w_);
+
+            row[i] = (ret + 1.f) / 2.f;
+        }
+
+        write(j, row.data());
+    }
+}
+
+void perlin_gen::fill_grid(float32 x0, float32 y0, float32 dx, float32 dy, int w, int h, float32 z, float32* out) const {
+    fill_grid_rows(x0, y0, dx, dy, w, h, z, [out, w](int j, const float32* values) {
+        std::copy(values, values + w, out + static_cast<size_t>(j) * w);
+    });
+}
+
+void perlin_gen::fill_grid(float32 x0, float32 y0, float32 dx, float32 dy, int w, int h, float32 z,
+    float32 scale, int bias, int mask, uint8* out, int stride) const {
+    fill_grid_rows(x0, y0, dx, dy, w, h, z, [=](int j, const float32* values) {
+        uint8* dest = out + static_cast<size_t>(j) * stride;
+        for (int i = 0; i < w; ++i) {
+            dest[i] = static_cast<uint8>((static_cast<int>(values[i] * scale) + bias) & mask);
+        }
+    });
 }
\ No newline at end of file
@@ -1,10 +1,18 @@
 #include <algorithm>
+#include <cmath>
 #include <random>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <SDL2/SDL.h>
 
 #include "pico8.h"
+#include "pico8_audio.h"
+#include "pico8_cart.h"
+#include "pico8_coro.h"
+#include "pico8_shm.h"
+#include "pico8_watch.h"
 #include "renderer.h"
 
 void print_fixed(const pico8::fixed16& f)
@@ -44,6 +52,9 @@ namespace pico8
 
     using namespace literals;
 
+    // page aligned so the whole machine can be mapped or protected page by page, allocated on first init
+    static byte* s_localMemory = nullptr;
+
     struct
     {
         SDL_Surface* screen = nullptr;
@@ -51,14 +62,27 @@ namespace pico8
         int width = 0;
         int height = 0;
         fixed16 time = 0;
-        byte memory[0x8000];
-        fixed16 sleepTimer = 0;
+        byte* memory = nullptr;
+        shm::View shared;
+        // owned copy, the caller's string may be long gone by the time the segment is unlinked
+        std::string sharedName;
+        fixed16 wakeTime = 0;
+        audio::Synth synth;
+        cart::Cart cart;
         struct
         {
             pico8_callback initFn;
             pico8_callback updateFn;
             pico8_callback drawFn;
         } callbacks;
+        struct
+        {
+            pico8_script updateFn;
+            pico8_script drawFn;
+            co::Script update;
+            co::Script draw;
+        } scripts;
+        co::FramePool framePool;
     } g_pico8;
 
     const uint32 k_screenCoordMask = 0x7F;
@@ -84,6 +108,36 @@ namespace pico8
 
     static std::unordered_map<uint32, uint8> s_picoColorsMap;
 
+    const size_t k_addrPenColor = k_offsetDrawState + 0x25;
+    const size_t k_addrCursorX = k_offsetDrawState + 0x26;
+    const size_t k_addrCursorY = k_offsetDrawState + 0x27;
+
+    const int k_glyphWidth = 4;
+    const int k_glyphHeight = 6;
+
+    // 3x5 glyphs in a 4x6 cell for characters 32-127, row r lives in bits [r*4, r*4+4) with bit 0 the leftmost
+    // pixel. lowercase shares the uppercase glyphs the same way pico8 displays them.
+    const uint32 k_font[96] = {
+        0x000000, 0x020222, 0x000055, 0x057575, 0x027637, 0x051245, 0x075733, 0x000012,
+        0x021112, 0x024442, 0x052725, 0x002720, 0x012000, 0x000700, 0x020000, 0x012224,
+        0x075557, 0x072223, 0x071747, 0x074647, 0x044755, 0x074717, 0x075711, 0x044447,
+        0x075757, 0x044757, 0x002020, 0x012020, 0x042124, 0x007070, 0x012421, 0x020647,
+        0x061552, 0x055757, 0x075357, 0x061116, 0x075553, 0x071317, 0x011317, 0x075116,
+        0x055755, 0x072227, 0x032227, 0x055355, 0x071111, 0x055577, 0x055553, 0x035556,
+        0x011757, 0x063552, 0x055357, 0x034716, 0x022227, 0x065555, 0x027555, 0x077555,
+        0x055255, 0x074755, 0x071247, 0x031113, 0x042221, 0x064446, 0x000052, 0x070000,
+        0x000042, 0x055757, 0x075357, 0x061116, 0x075553, 0x071317, 0x011317, 0x075116,
+        0x055755, 0x072227, 0x032227, 0x055355, 0x071111, 0x055577, 0x055553, 0x035556,
+        0x011757, 0x063552, 0x055357, 0x034716, 0x022227, 0x065555, 0x027555, 0x077555,
+        0x055255, 0x074755, 0x071247, 0x062326, 0x022222, 0x032623, 0x001740, 0x000000,
+    };
+
+    // one bit per pixel -> one nibble per pixel
+    const uint16 k_nibbleExpand[16] = {
+        0x0000, 0x000F, 0x00F0, 0x00FF, 0x0F00, 0x0F0F, 0x0FF0, 0x0FFF,
+        0xF000, 0xF00F, 0xF0F0, 0xF0FF, 0xFF00, 0xFF0F, 0xFFF0, 0xFFFF,
+    };
+
     static std::random_device rd;
     static std::mt19937 rgen(rd());
     static std::uniform_real_distribution<float32> rdist(0.f, 1.f);
@@ -210,12 +264,8 @@ namespace pico8
 
     void srand(uint32 seed);
 
-    void system_init(pico8_callback initFn, pico8_callback updateFn, pico8_callback drawFn)
+    void _system_init()
     {
-        g_pico8.callbacks = {
-            initFn, updateFn, drawFn
-        };
-
         g_pico8.width = 128;
         g_pico8.height = 128;
         g_pico8.screen = SDL_CreateRGBSurface(0, g_pico8.width, g_pico8.height,
@@ -229,7 +279,17 @@ namespace pico8
 
         g_pico8.pixels = reinterpret_cast<uint32*>(g_pico8.screen->pixels);
 
-        std::memset(g_pico8.memory, 0, sizeof(g_pico8.memory));
+        if (s_localMemory == nullptr)
+        {
+            s_localMemory = shm::allocate_pages(k_memorySize);
+        }
+        if (g_pico8.memory == nullptr)
+        {
+            g_pico8.memory = s_localMemory;
+        }
+
+        std::memset(g_pico8.memory, 0, k_memorySize);
+        watch::attach(g_pico8.memory, k_memorySize);
 
         for (uint8 i = 0; i < 16; ++i)
         {
@@ -238,14 +298,54 @@ namespace pico8
 
         srand(rgen.default_seed);
 
+        audio::init(g_pico8.synth, g_pico8.memory);
+
+        co::init_pool(g_pico8.framePool);
+        co::bind_pool(&g_pico8.framePool);
+
         if (g_pico8.callbacks.initFn)
         {
             g_pico8.callbacks.initFn();
         }
     }
 
+    void system_init(pico8_callback initFn, pico8_callback updateFn, pico8_callback drawFn)
+    {
+        g_pico8.callbacks = {
+            initFn, updateFn, drawFn
+        };
+        g_pico8.scripts.updateFn = nullptr;
+        g_pico8.scripts.drawFn = nullptr;
+
+        _system_init();
+    }
+
+    void system_init(pico8_callback initFn, pico8_script updateFn, pico8_script drawFn)
+    {
+        g_pico8.callbacks = {
+            initFn, nullptr, nullptr
+        };
+        g_pico8.scripts.updateFn = updateFn;
+        g_pico8.scripts.drawFn = drawFn;
+
+        _system_init();
+    }
+
     void system_shutdown()
     {
+        // frames go back to the pool before it goes away
+        g_pico8.scripts.update = co::Script{};
+        g_pico8.scripts.draw = co::Script{};
+        co::bind_pool(nullptr);
+
+        if (g_pico8.synth.voice >= 0)
+        {
+            audio::detach(g_pico8.synth);
+            audio::close_device();
+        }
+        system_unshare_memory();
+        watch::detach();
+
         SDL_FreeSurface(g_pico8.screen);
 
         g_pico8.width = 0;
@@ -254,26 +354,72 @@ namespace pico8
         g_pico8.pixels = nullptr;
     }
 
-    void system_update(float32 dt)
+    bool system_open_audio(bool headless)
     {
-        if (g_pico8.sleepTimer > 0_fx16)
+        return audio::open_device(headless) && audio::attach(g_pico8.synth);
+    }
+
+    bool system_share_memory(const char* name)
+    {
+        system_unshare_memory();
+
+        if (!shm::create(name, k_memorySize, g_pico8.shared))
+        {
+            return false;
+        }
+
+        // machine keeps running from the shared copy, nothing else holds on to the old pointer
+        std::memcpy(g_pico8.shared.memory, g_pico8.memory, k_memorySize);
+        g_pico8.memory = g_pico8.shared.memory;
+        g_pico8.sharedName = name;
+        g_pico8.synth.memory = g_pico8.memory;
+        watch::attach(g_pico8.memory, k_memorySize);
+        return true;
+    }
+
+    void system_unshare_memory()
+    {
+        if (g_pico8.sharedName.empty())
         {
-            g_pico8.sleepTimer -= dt;
             return;
         }
 
+        std::memcpy(s_localMemory, g_pico8.memory, k_memorySize);
+        g_pico8.memory = s_localMemory;
+        g_pico8.synth.memory = g_pico8.memory;
+        watch::attach(g_pico8.memory, k_memorySize);
+
+        shm::destroy(g_pico8.shared, g_pico8.sharedName.c_str());
+        g_pico8.sharedName.clear();
+    }
+
+    void system_update(float32 dt)
+    {
+        audio::pump(g_pico8.synth);
+        watch::next_frame();
+        shm::begin_frame(g_pico8.shared);
+
         g_pico8.time += static_cast<fixed16>(dt);
 
+        if (g_pico8.time < g_pico8.wakeTime)
+        {
+            shm::end_frame(g_pico8.shared);
+            return;
+        }
+
         if (g_pico8.callbacks.updateFn)
         {
             g_pico8.callbacks.updateFn();
         }
+
+        co::run(g_pico8.scripts.update, g_pico8.scripts.updateFn, g_pico8.time);
     }
 
     void system_draw()
     {
-        if (g_pico8.sleepTimer > 0_fx16)
+        if (g_pico8.time < g_pico8.wakeTime)
         {
+            shm::end_frame(g_pico8.shared);
             return;
         }
 
@@ -282,7 +428,21 @@ namespace pico8
             g_pico8.callbacks.drawFn();
         }
 
+        co::run(g_pico8.scripts.draw, g_pico8.scripts.drawFn, g_pico8.time);
+
         flip();
+
+        shm::end_frame(g_pico8.shared);
+    }
+
+    void system_draw_debug_ui()
+    {
+        if (g_pico8.screen == nullptr)
+        {
+            return;
+        }
+
+        watch::draw_debug_ui();
     }
 
     fixed16 peek(fixed16 addr)
@@ -299,7 +459,35 @@ namespace pico8
 
     void sleep(fixed16 seconds)
     {
-        g_pico8.sleepTimer += seconds;
+        g_pico8.wakeTime = std::max(g_pico8.wakeTime, g_pico8.time) + seconds;
+    }
+
+    void sfx(fixed16 n, fixed16 channel, fixed16 offset, fixed16 length)
+    {
+        audio::play_sfx(g_pico8.synth, n, channel, offset, length);
+    }
+
+    void music(fixed16 n, fixed16 fadeLength, fixed16 channelMask)
+    {
+        audio::play_music(g_pico8.synth, n, fadeLength, channelMask);
+    }
+
+    bool system_load_cart(const char* filename)
+    {
+        audio::stop_music(g_pico8.synth);
+        audio::stop_sfx(g_pico8.synth, -1);
+
+        return cart::try_load(filename, g_pico8.memory, g_pico8.cart);
+    }
+
+    const char* system_cart_code()
+    {
+        return g_pico8.cart.code.c_str();
+    }
+
+    byte* get_memory()
+    {
+        return g_pico8.memory;
     }
 
     void flip()
@@ -598,99 +786,592 @@ namespace pico8
         }
     }
 
-    void circ(fixed16 x, fixed16 y, fixed16 r, fixed16 c)
+    // circles and ovals are drawn from tables of how far each row is inset from the edges of the bounding box.
+    // only the top half is stored, the bottom half mirrors it. tables are kept in a small lru keyed on box size
+    // since particle heavy carts draw the same few radii over and over
+    struct span_table
     {
-        aarect bounds = make_aarect(x - r, y - r, x + r, y + r);
-        if (!clip_rect(bounds))
+        int width = 0;
+        int height = 0;
+        bool circle = false;
+        uint32 lastUse = 0;
+        std::vector<int> insets;
+    };
+
+    const int k_spanTableCacheSize = 16;
+    static span_table s_spanTables[k_spanTableCacheSize];
+    static uint32 s_spanTableClock = 0;
+
+    void build_circle_spans(int r, std::vector<int>& insets)
+    {
+        // midpoint circle, keeps the widest x seen on each row
+        std::vector<int> halfWidths(r + 1, 0);
+
+        int x = r;
+        int y = 0;
+        int err = 0;
+
+        while (x >= y)
         {
-            return;
+            halfWidths[y] = std::max(halfWidths[y], x);
+            halfWidths[x] = std::max(halfWidths[x], y);
+
+            if (err <= 0)
+            {
+                ++y;
+                err += 2 * y + 1;
+            }
+
+            if (err > 0)
+            {
+                --x;
+                err -= 2 * x + 1;
+            }
+        }
+
+        insets.resize(r + 1);
+        for (int i = 0; i <= r; ++i)
+        {
+            insets[i] = r - halfWidths[r - i];
         }
+    }
 
-        int x0 = static_cast<int>(x);
-        int y0 = static_cast<int>(y);
+    void build_oval_spans(int w, int h, std::vector<int>& insets)
+    {
+        const int rows = (h + 1) / 2;
+        const float32 a = w * 0.5f;
+        const float32 b = h * 0.5f;
+        const float32 centerX = (w - 1) * 0.5f;
+        const float32 centerY = (h - 1) * 0.5f;
+
+        insets.resize(rows);
+        for (int i = 0; i < rows; ++i)
+        {
+            float32 dy = (centerY - i) / b;
+            float32 halfWidth = a * std::sqrt(std::max(0.0f, 1.0f - dy * dy));
+            int inset = static_cast<int>(std::floor(centerX - halfWidth + 0.5f));
+            insets[i] = std::clamp(inset, 0, (w - 1) / 2);
+        }
+    }
 
-        auto putpixel = [](int x, int y, uint8 c) {
-            if (clip_point(x, y)) {
-                _pset(x, y, pixel_mask(x), c);
+    const span_table& get_span_table(int w, int h, bool circle)
+    {
+        ++s_spanTableClock;
+
+        span_table* oldest = &s_spanTables[0];
+        for (span_table& table : s_spanTables)
+        {
+            if (table.width == w && table.height == h && table.circle == circle)
+            {
+                table.lastUse = s_spanTableClock;
+                return table;
             }
-        };
 
-        auto plot8 = [x0, y0, putpixel](int dx, int dy, uint8 c)
+            if (table.lastUse < oldest->lastUse)
+            {
+                oldest = &table;
+            }
+        }
+
+        oldest->width = w;
+        oldest->height = h;
+        oldest->circle = circle;
+        oldest->lastUse = s_spanTableClock;
+
+        if (circle)
         {
-            putpixel(x0 + dx, y0 + dy, c);
-            putpixel(x0 + dy, y0 + dx, c);
-            putpixel(x0 + dx, y0 - dy, c);
-            putpixel(x0 + dy, y0 - dx, c);
-            putpixel(x0 - dx, y0 + dy, c);
-            putpixel(x0 - dy, y0 + dx, c);
-            putpixel(x0 - dx, y0 - dy, c);
-            putpixel(x0 - dy, y0 - dx, c);
-        };
+            build_circle_spans((w - 1) / 2, oldest->insets);
+        }
+        else
+        {
+            build_oval_spans(w, h, oldest->insets);
+        }
 
+        return *oldest;
+    }
+
+    // clips a single row span and hands it to the span writer
+    inline void _clipped_hline(int y, int left, int right, uint8 c)
+    {
+        left = std::max(left, static_cast<int>(s_clipRect.x0));
+        right = std::min(right, static_cast<int>(s_clipRect.x1));
+
+        if (left <= right)
         {
-            int x = static_cast<int>(r);
-            int y = 0;
-            int err = 0;
+            _hline(y, left, right, c);
+        }
+    }
 
-            while (x >= y)
+    // x0, y0 is the top left of the bounding box, every row of the shape is emitted exactly once
+    void _draw_spans(const span_table& table, int x0, int y0, bool fill, uint8 c)
+    {
+        const int x1 = x0 + table.width - 1;
+        const int y1 = y0 + table.height - 1;
+        const int rows = static_cast<int>(table.insets.size());
+        const int clipY0 = static_cast<int>(s_clipRect.y0);
+        const int clipY1 = static_cast<int>(s_clipRect.y1);
+
+        for (int i = 0; i < rows; ++i)
+        {
+            int top = y0 + i;
+            int bottom = y1 - i;
+
+            bool drawTop = top >= clipY0 && top <= clipY1;
+            bool drawBottom = bottom != top && bottom >= clipY0 && bottom <= clipY1;
+            if (!drawTop && !drawBottom)
             {
-                plot8(x, y, c);
+                continue;
+            }
 
-                if (err <= 0)
+            int inset = table.insets[i];
+            int left = x0 + inset;
+            int right = x1 - inset;
+
+            // outlines cover from this row's edge up to where the row above starts, so steep parts stay connected
+            int edge = left;
+            if (!fill && i > 0)
+            {
+                edge = std::max(left, x0 + table.insets[i - 1] - 1);
+            }
+
+            if (fill || i == 0 || edge >= right - (edge - left))
+            {
+                if (drawTop) _clipped_hline(top, left, right, c);
+                if (drawBottom) _clipped_hline(bottom, left, right, c);
+            }
+            else
+            {
+                int rightEdge = right - (edge - left);
+                if (drawTop)
                 {
-                    ++y;
-                    err += 2 * y + 1;
+                    _clipped_hline(top, left, edge, c);
+                    _clipped_hline(top, rightEdge, right, c);
                 }
-
-                if (err > 0)
+                if (drawBottom)
                 {
-                    --x;
-                    err -= 2 * x + 1;
+                    _clipped_hline(bottom, left, edge, c);
+                    _clipped_hline(bottom, rightEdge, right, c);
                 }
             }
         }
     }
 
-    void circfill(fixed16 x, fixed16 y, fixed16 r, fixed16 c)
+    void _circ(fixed16 x, fixed16 y, fixed16 r, fixed16 c, bool fill)
     {
+        int radius = static_cast<int>(r);
+        if (radius < 0)
+        {
+            return;
+        }
+
         aarect bounds = make_aarect(x - r, y - r, x + r, y + r);
         if (!clip_rect(bounds))
         {
             return;
         }
 
-        int x0 = static_cast<int>(x);
-        int y0 = static_cast<int>(y);
+        int size = radius * 2 + 1;
+        const span_table& table = get_span_table(size, size, true);
+        _draw_spans(table, static_cast<int>(x) - radius, static_cast<int>(y) - radius, fill, static_cast<uint8>(c));
+    }
 
-        auto scanline4 = [x0, y0](int dx, int dy, uint8 c)
+    void circ(fixed16 x, fixed16 y, fixed16 r, fixed16 c)
+    {
+        _circ(x, y, r, c, false);
+    }
+
+    void circfill(fixed16 x, fixed16 y, fixed16 r, fixed16 c)
+    {
+        _circ(x, y, r, c, true);
+    }
+
+    void _oval(fixed16 x0fx, fixed16 y0fx, fixed16 x1fx, fixed16 y1fx, fixed16 c, bool fill)
+    {
+        int x0 = static_cast<int>(x0fx);
+        int y0 = static_cast<int>(y0fx);
+        int x1 = static_cast<int>(x1fx);
+        int y1 = static_cast<int>(y1fx);
+
+        if (x1 < x0) std::swap(x0, x1);
+        if (y1 < y0) std::swap(y0, y1);
+
+        aarect bounds = make_aarect(x0, y0, x1, y1);
+        if (!clip_rect(bounds))
         {
-            hline(y0 - dy, x0 - dx, x0 + dx, c);
-            hline(y0 - dx, x0 - dy, x0 + dy, c);
-            hline(y0 + dy, x0 - dx, x0 + dx, c);
-            hline(y0 + dx, x0 - dy, x0 + dy, c);
-        };
+            return;
+        }
+
+        const span_table& table = get_span_table(x1 - x0 + 1, y1 - y0 + 1, false);
+        _draw_spans(table, x0, y0, fill, static_cast<uint8>(c));
+    }
+
+    void oval(fixed16 x0, fixed16 y0, fixed16 x1, fixed16 y1, fixed16 c)
+    {
+        _oval(x0, y0, x1, y1, c, false);
+    }
+
+    void ovalfill(fixed16 x0, fixed16 y0, fixed16 x1, fixed16 y1, fixed16 c)
+    {
+        _oval(x0, y0, x1, y1, c, true);
+    }
+
+    void color(fixed16 c)
+    {
+        g_pico8.memory[k_addrPenColor] = static_cast<uint8>(c) & 0xF;
+    }
+
+    void cursor(fixed16 x, fixed16 y)
+    {
+        g_pico8.memory[k_addrCursorX] = static_cast<uint8>(x);
+        g_pico8.memory[k_addrCursorY] = static_cast<uint8>(y);
+    }
+
+    void cursor(fixed16 x, fixed16 y, fixed16 c)
+    {
+        cursor(x, y);
+        color(c);
+    }
+
+    // writes one glyph a row at a time, each row is a single masked read-modify-write of the bytes it covers
+    void _print_glyph(int x, int y, uint32 glyph, uint8 columnMask, int rowBegin, int rowEnd, uint32 colorWord)
+    {
+        int base = x >> 1;
+        uint32 shift = static_cast<uint32>(x & 1) * 4;
 
+        for (int row = rowBegin; row < rowEnd; ++row)
         {
-            int x = static_cast<int>(r);
-            int y = 0;
-            int err = 0;
+            uint32 bits = (glyph >> (row * 4)) & columnMask;
+            if (bits == 0)
+            {
+                continue;
+            }
 
-            while (x >= y)
+            uint32 mask = static_cast<uint32>(k_nibbleExpand[bits]) << shift;
+            int b = base;
+            if (b < 0)
             {
-                scanline4(x, y, c);
+                // clipped columns left of the screen edge are already masked out
+                mask >>= (-b * 8);
+                b = 0;
+            }
 
-                if (err <= 0)
+            uint8* addr = &g_pico8.memory[k_offsetScreenData + static_cast<size_t>(y + row) * 64 + b];
+            if (b <= 60)
+            {
+                uint32 word;
+                std::memcpy(&word, addr, sizeof(word));
+                word = (word & ~mask) | (colorWord & mask);
+                std::memcpy(addr, &word, sizeof(word));
+            }
+            else
+            {
+                for (int i = 0; i < 64 - b; ++i, mask >>= 8)
                 {
-                    ++y;
-                    err += 2 * y + 1;
+                    uint8 m = static_cast<uint8>(mask);
+                    addr[i] = static_cast<uint8>((addr[i] & ~m) | (colorWord & m));
                 }
+            }
+        }
+    }
 
-                if (err > 0)
+    fixed16 print(const char* str, fixed16 xfx, fixed16 yfx, fixed16 c)
+    {
+        color(c);
+
+        const int clipX0 = static_cast<int>(s_clipRect.x0);
+        const int clipY0 = static_cast<int>(s_clipRect.y0);
+        const int clipX1 = static_cast<int>(s_clipRect.x1);
+        const int clipY1 = static_cast<int>(s_clipRect.y1);
+
+        const uint32 colorWord = (static_cast<uint32>(static_cast<uint8>(c)) & 0xF) * 0x11111111u;
+
+        const int left = static_cast<int>(xfx);
+        int x = left;
+        int y = static_cast<int>(yfx);
+
+        for (const char* ch = str; *ch != '\0'; ++ch)
+        {
+            uint8 code = static_cast<uint8>(*ch);
+            if (code == '\n')
+            {
+                x = left;
+                y += k_glyphHeight;
+                continue;
+            }
+
+            uint32 glyph = (code >= 32 && code < 128) ? k_font[code - 32] : 0;
+
+            if (glyph != 0 &&
+                x + k_glyphWidth > clipX0 && x <= clipX1 &&
+                y + k_glyphHeight > clipY0 && y <= clipY1)
+            {
+                uint8 columnMask = 0;
+                for (int i = 0; i < k_glyphWidth; ++i)
                 {
-                    --x;
-                    err -= 2 * x + 1;
+                    if (x + i >= clipX0 && x + i <= clipX1)
+                    {
+                        columnMask |= (1 << i);
+                    }
                 }
+
+                int rowBegin = std::max(0, clipY0 - y);
+                int rowEnd = std::min(k_glyphHeight, clipY1 - y + 1);
+
+                _print_glyph(x, y, glyph, columnMask, rowBegin, rowEnd, colorWord);
+            }
+
+            x += k_glyphWidth;
+        }
+
+        cursor(left, y + k_glyphHeight);
+
+        return x;
+    }
+
+    fixed16 print(const char* str, fixed16 x, fixed16 y)
+    {
+        return print(str, x, y, g_pico8.memory[k_addrPenColor]);
+    }
+
+    fixed16 print(const char* str)
+    {
+        return print(str, g_pico8.memory[k_addrCursorX], g_pico8.memory[k_addrCursorY], g_pico8.memory[k_addrPenColor]);
+    }
+
+    // byte offset of each sprite's top left texel in the sprite sheet, 16 sprites per row of 8 lines
+    struct sprite_addr_table
+    {
+        uint16 addr[256];
+
+        constexpr sprite_addr_table() : addr()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                addr[i] = static_cast<uint16>(k_offsetSpriteSheet + (i / 16) * 8 * 64 + (i % 16) * 4);
             }
         }
+    };
+
+    constexpr sprite_addr_table k_spriteAddr;
+
+    const int k_mapWidth = 128;
+    const int k_mapHeight = 64;
+
+    // samples 4bpp texels through the map, remembering the last tile so runs inside one tile skip the map lookup
+    struct map_sampler
+    {
+        int lastTile = -1;
+        const uint8* tileBase = nullptr;
+
+        inline uint8 sample(int32 mx, int32 my)
+        {
+            int tx = mx >> fixed16::k_bitsOfPrecision;
+            int ty = my >> fixed16::k_bitsOfPrecision;
+
+            if (static_cast<uint32>(tx) >= k_mapWidth || static_cast<uint32>(ty) >= k_mapHeight)
+            {
+                return 0;
+            }
+
+            int key = (ty << 8) | tx;
+            if (key != lastTile)
+            {
+                lastTile = key;
+
+                // bottom half of the map is shared with the bottom half of the sprite sheet
+                uint8 tile = (ty < 32)
+                    ? g_pico8.memory[k_offsetMap + ty * k_mapWidth + tx]
+                    : g_pico8.memory[k_offsetSharedSpriteMap + (ty - 32) * k_mapWidth + tx];
+
+                tileBase = (tile != 0) ? &g_pico8.memory[k_spriteAddr.addr[tile]] : nullptr;
+            }
+
+            if (tileBase == nullptr)
+            {
+                return 0;
+            }
+
+            // 3 bits of texel from the top of the fraction
+            int px = (mx >> (fixed16::k_bitsOfPrecision - 3)) & 7;
+            int py = (my >> (fixed16::k_bitsOfPrecision - 3)) & 7;
+
+            uint8 texels = tileBase[py * 64 + (px >> 1)];
+            return ((px & 1) != 0) ? (texels >> 4) : (texels & 0xF);
+        }
+    };
+
+    void _tline_span(int y, int x0, int x1, int32 mx, int32 my, int32 mdx, int32 mdy)
+    {
+        map_sampler sampler;
+        uint8* row = &g_pico8.memory[k_offsetScreenData + static_cast<size_t>(y) * 64];
+
+        int x = x0;
+
+        // odd leading pixel, then whole bytes
+        if ((x & 1) != 0 && x <= x1)
+        {
+            uint8 c = sampler.sample(mx, my);
+            if (c != 0)
+            {
+                row[x >> 1] = static_cast<uint8>((row[x >> 1] & k_maskLeft) | (c << 4));
+            }
+            mx += mdx; my += mdy; ++x;
+        }
+
+        for (; x + 1 <= x1; x += 2)
+        {
+            uint8 left = sampler.sample(mx, my);
+            uint8 right = sampler.sample(mx + mdx, my + mdy);
+            mx += mdx * 2; my += mdy * 2;
+
+            if ((left | right) == 0)
+            {
+                continue;
+            }
+
+            uint8 mask = ((left != 0) ? k_maskLeft : 0) | ((right != 0) ? k_maskRight : 0);
+            uint8& texels = row[x >> 1];
+            texels = static_cast<uint8>((texels & ~mask) | ((left | (right << 4)) & mask));
+        }
+
+        if (x <= x1)
+        {
+            uint8 c = sampler.sample(mx, my);
+            if (c != 0)
+            {
+                row[x >> 1] = static_cast<uint8>((row[x >> 1] & k_maskRight) | c);
+            }
+        }
+    }
+
+    void _tline_column(int x, int y0, int y1, int32 mx, int32 my, int32 mdx, int32 mdy)
+    {
+        map_sampler sampler;
+        uint8* addr = get_pixel_addr(x, y0);
+        const uint8 mask = pixel_mask(x);
+        const int shift = ((x & 1) != 0) ? 4 : 0;
+
+        for (int y = y0; y <= y1; ++y, addr += 64)
+        {
+            uint8 c = sampler.sample(mx, my);
+            if (c != 0)
+            {
+                *addr = static_cast<uint8>((*addr & ~mask) | (c << shift));
+            }
+            mx += mdx; my += mdy;
+        }
+    }
+
+    void tline(fixed16 x0fx, fixed16 y0fx, fixed16 x1fx, fixed16 y1fx, fixed16 mxfx, fixed16 myfx, fixed16 mdxfx, fixed16 mdyfx)
+    {
+        int x0 = static_cast<int>(x0fx);
+        int y0 = static_cast<int>(y0fx);
+        int x1 = static_cast<int>(x1fx);
+        int y1 = static_cast<int>(y1fx);
+
+        int32 mx = mxfx.raw();
+        int32 my = myfx.raw();
+        int32 mdx = mdxfx.raw();
+        int32 mdy = mdyfx.raw();
+
+        const int clipX0 = static_cast<int>(s_clipRect.x0);
+        const int clipY0 = static_cast<int>(s_clipRect.y0);
+        const int clipX1 = static_cast<int>(s_clipRect.x1);
+        const int clipY1 = static_cast<int>(s_clipRect.y1);
+
+        // the map position always starts at (x0, y0), so spans drawn right to left are flipped
+        // to run left to right with the map stepping backwards
+        if (y0 == y1)
+        {
+            if (y0 < clipY0 || y0 > clipY1)
+            {
+                return;
+            }
+
+            if (x1 < x0)
+            {
+                int count = x0 - x1;
+                mx += mdx * count; my += mdy * count;
+                mdx = -mdx; mdy = -mdy;
+                std::swap(x0, x1);
+            }
+
+            if (x0 < clipX0)
+            {
+                int skip = clipX0 - x0;
+                mx += mdx * skip; my += mdy * skip;
+                x0 = clipX0;
+            }
+            x1 = std::min(x1, clipX1);
+
+            if (x0 <= x1)
+            {
+                _tline_span(y0, x0, x1, mx, my, mdx, mdy);
+            }
+            return;
+        }
+
+        if (x0 == x1)
+        {
+            if (x0 < clipX0 || x0 > clipX1)
+            {
+                return;
+            }
+
+            if (y1 < y0)
+            {
+                int count = y0 - y1;
+                mx += mdx * count; my += mdy * count;
+                mdx = -mdx; mdy = -mdy;
+                std::swap(y0, y1);
+            }
+
+            if (y0 < clipY0)
+            {
+                int skip = clipY0 - y0;
+                mx += mdx * skip; my += mdy * skip;
+                y0 = clipY0;
+            }
+            y1 = std::min(y1, clipY1);
+
+            if (y0 <= y1)
+            {
+                _tline_column(x0, y0, y1, mx, my, mdx, mdy);
+            }
+            return;
+        }
+
+        // diagonal lines step one pixel along the major axis and walk the minor axis in 16.16
+        int dx = x1 - x0;
+        int dy = y1 - y0;
+        int steps = std::max(std::abs(dx), std::abs(dy));
+
+        int32 px = x0 << fixed16::k_bitsOfPrecision;
+        int32 py = y0 << fixed16::k_bitsOfPrecision;
+        int32 sx = (dx << fixed16::k_bitsOfPrecision) / steps;
+        int32 sy = (dy << fixed16::k_bitsOfPrecision) / steps;
+
+        // round to the nearest pixel on the minor axis
+        px += fixed16::k_precisionBit / 2;
+        py += fixed16::k_precisionBit / 2;
+
+        map_sampler sampler;
+        for (int i = 0; i <= steps; ++i)
+        {
+            int x = px >> fixed16::k_bitsOfPrecision;
+            int y = py >> fixed16::k_bitsOfPrecision;
+
+            if (clip_point(x, y))
+            {
+                uint8 c = sampler.sample(mx, my);
+                if (c != 0)
+                {
+                    _pset(x, y, pixel_mask(x), c);
+                }
+            }
+
+            px += sx; py += sy;
+            mx += mdx; my += mdy;
+        }
     }
 }
\ No newline at end of file
@@ -274,6 +274,22 @@ namespace pico8
     void system_update(float32 dt);
     void system_draw();
 
+    // debug panels for the running machine (watchpoints), drawn into whatever imgui window is current.
+    // does nothing until system_init has run
+    void system_draw_debug_ui();
+
+    // machines start silent, this opens the audio device (see pico8_audio.h) and plays this machine through it
+    bool system_open_audio(bool headless = false);
+
+    // moves machine memory into a named shared memory segment (see pico8_shm.h) so other processes can watch it
+    bool system_share_memory(const char* name);
+    void system_unshare_memory();
+
+    // loads a .p8 or .p8.png cart's rom (gfx, map, flags, sfx, music) into machine memory. the lua source is
+    // kept around in system_cart_code() since there's nothing here to run it
+    bool system_load_cart(const char* filename);
+    const char* system_cart_code();
+
     fixed16 peek(fixed16 addr);
     void poke(fixed16 addr, fixed16 value);
     
@@ -295,8 +311,29 @@ namespace pico8
     void rectfill(fixed16 x, fixed16 y, fixed16 w, fixed16 h, fixed16 c);
     void circ(fixed16 x, fixed16 y, fixed16 r, fixed16 c);
     void circfill(fixed16 x, fixed16 y, fixed16 r, fixed16 c);
+    void oval(fixed16 x0, fixed16 y0, fixed16 x1, fixed16 y1, fixed16 c);
+    void ovalfill(fixed16 x0, fixed16 y0, fixed16 x1, fixed16 y1, fixed16 c);
+
+    // textured line, samples the map starting at tile (mx, my) and steps (mdx, mdy) tiles per pixel.
+    // tile 0 and colour 0 are transparent
+    void tline(fixed16 x0, fixed16 y0, fixed16 x1, fixed16 y1, fixed16 mx, fixed16 my, fixed16 mdx = 0.125f, fixed16 mdy = 0);
 
+    void color(fixed16 c = 6);
+    void cursor(fixed16 x = 0, fixed16 y = 0);
+    void cursor(fixed16 x, fixed16 y, fixed16 c);
+
+    // prints with pico8's 4x6 font, returns the x position after the last character
+    fixed16 print(const char* str);
+    fixed16 print(const char* str, fixed16 x, fixed16 y);
+    fixed16 print(const char* str, fixed16 x, fixed16 y, fixed16 c);
+
+    // pauses the whole machine, coroutine scripts can co_await co::sleep() to wait on their own (see pico8_coro.h)
     void sleep(fixed16 seconds);
 
+    void sfx(fixed16 n, fixed16 channel = -1, fixed16 offset = 0, fixed16 length = 32);
+    void music(fixed16 n, fixed16 fadeLength = 0, fixed16 channelMask = 0);
+
+    byte* get_memory();
+
     
 }
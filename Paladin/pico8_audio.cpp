@@ -0,0 +1,863 @@
+#include "pico8_audio.h"
+
+#include <SDL2/SDL.h>
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+
+#include "pico8.h"
+
+namespace pico8
+{
+    namespace audio
+    {
+        // roughly 70ms at 22050hz, enough to ride out a dropped frame without audible lag
+        const size_t k_targetLatency = 1536;
+        const size_t k_ringCapacity = 8192;
+
+        enum Waveform
+        {
+            k_waveTriangle,
+            k_waveTiltedSaw,
+            k_waveSaw,
+            k_waveSquare,
+            k_wavePulse,
+            k_waveOrgan,
+            k_waveNoise,
+            k_wavePhaser,
+        };
+
+        enum Effect
+        {
+            k_fxNone,
+            k_fxSlide,
+            k_fxVibrato,
+            k_fxDrop,
+            k_fxFadeIn,
+            k_fxFadeOut,
+            k_fxArpFast,
+            k_fxArpSlow,
+        };
+
+        struct Note
+        {
+            int pitch;
+            int waveform;
+            int volume;
+            int effect;
+            // waveform is the sfx (0-7) to play as an instrument
+            bool custom;
+        };
+
+        // the callback owns the consumer side of every ring, attach/detach only touch voices with the device locked
+        static struct
+        {
+            SDL_AudioDeviceID device = 0;
+            struct
+            {
+                const Synth* owner = nullptr;
+                SpscRing<int16, k_ringCapacity> ring;
+            } voices[k_maxVoices];
+            std::atomic<uint32> underruns = 0;
+        } s_device;
+
+        const byte* sfx_addr(const Synth& self, int sfx)
+        {
+            return self.memory + k_offsetSfx + static_cast<size_t>(sfx) * k_sfxSize;
+        }
+
+        Note decode_note(const byte* sfx, int index)
+        {
+            uint16 bits = static_cast<uint16>(sfx[index * 2] | (sfx[index * 2 + 1] << 8));
+
+            return Note{
+                bits & 0x3F,
+                (bits >> 6) & 0x7,
+                (bits >> 9) & 0x7,
+                (bits >> 12) & 0x7,
+                (bits & 0x8000) != 0,
+            };
+        }
+
+        inline int sfx_speed(const byte* sfx)
+        {
+            return std::max(1, static_cast<int>(sfx[65]));
+        }
+
+        inline int sfx_loop_start(const byte* sfx) { return sfx[66]; }
+        inline int sfx_loop_end(const byte* sfx) { return sfx[67]; }
+
+        inline bool sfx_loops(const byte* sfx)
+        {
+            return sfx_loop_end(sfx) > sfx_loop_start(sfx);
+        }
+
+        int sfx_length(const byte* sfx)
+        {
+            // a loop end of 0 with a loop start set means the loop start is the sfx length
+            if (sfx_loop_end(sfx) == 0 && sfx_loop_start(sfx) > 0)
+            {
+                return std::min(sfx_loop_start(sfx), k_sfxNoteCount);
+            }
+            return k_sfxNoteCount;
+        }
+
+        inline float32 pitch_frequency(int pitch)
+        {
+            // pitch 33 is A4
+            return 440.f * std::pow(2.f, (pitch - 33) / 12.f);
+        }
+
+        inline float32 triangle01(float32 t)
+        {
+            t -= std::floor(t);
+            return std::fabs(t * 4.f - 2.f) - 1.f;
+        }
+
+        // sse2 helpers, phases are always positive so truncation works as floor
+        inline __m128 fract4(__m128 v)
+        {
+            return _mm_sub_ps(v, _mm_cvtepi32_ps(_mm_cvttps_epi32(v)));
+        }
+
+        inline __m128 abs4(__m128 v)
+        {
+            return _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+        }
+
+        inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        inline __m128 triangle4(__m128 t)
+        {
+            return _mm_sub_ps(abs4(_mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(4.f)), _mm_set1_ps(2.f))), _mm_set1_ps(1.f));
+        }
+
+        template <int t_waveform>
+        inline __m128 waveform4(__m128 t, __m128 t2, __m128i& noise)
+        {
+            const __m128 one = _mm_set1_ps(1.f);
+
+            switch (t_waveform)
+            {
+            case k_waveTriangle:
+                return triangle4(t);
+            case k_waveTiltedSaw:
+            {
+                __m128 rise = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(2.f / 0.875f)), one);
+                __m128 fall = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(one, t), _mm_set1_ps(2.f / 0.125f)), one);
+                return select4(_mm_cmplt_ps(t, _mm_set1_ps(0.875f)), rise, fall);
+            }
+            case k_waveSaw:
+                return _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(2.f)), one), _mm_set1_ps(0.7f));
+            case k_waveSquare:
+                return _mm_mul_ps(select4(_mm_cmplt_ps(t, _mm_set1_ps(0.5f)), one, _mm_set1_ps(-1.f)), _mm_set1_ps(0.5f));
+            case k_wavePulse:
+                return _mm_mul_ps(select4(_mm_cmplt_ps(t, _mm_set1_ps(0.3125f)), one, _mm_set1_ps(-1.f)), _mm_set1_ps(0.5f));
+            case k_waveOrgan:
+                return _mm_mul_ps(_mm_add_ps(triangle4(t), triangle4(fract4(_mm_add_ps(t, t)))), _mm_set1_ps(0.5f));
+            case k_waveNoise:
+            {
+                // xorshift32 per lane
+                noise = _mm_xor_si128(noise, _mm_slli_epi32(noise, 13));
+                noise = _mm_xor_si128(noise, _mm_srli_epi32(noise, 17));
+                noise = _mm_xor_si128(noise, _mm_slli_epi32(noise, 5));
+                return _mm_mul_ps(_mm_cvtepi32_ps(noise), _mm_set1_ps(1.f / 2147483648.f));
+            }
+            case k_wavePhaser:
+                return _mm_mul_ps(_mm_add_ps(triangle4(t), triangle4(t2)), _mm_set1_ps(0.5f));
+            default:
+                return _mm_setzero_ps();
+            }
+        }
+
+        // adds count samples of the channel oscillator into out, count is rounded up to a multiple of 4
+        template <int t_waveform>
+        void generate(Channel& ch, float32* out, int count, float32 frequency, float32 volume)
+        {
+            const float32 step = frequency / k_sampleRate;
+            const float32 phaserStep = step * (1.f + 1.f / 128.f);
+
+            __m128 phase = _mm_add_ps(_mm_set1_ps(ch.phase), _mm_mul_ps(_mm_setr_ps(0.f, 1.f, 2.f, 3.f), _mm_set1_ps(step)));
+            __m128 phase2 = _mm_add_ps(_mm_set1_ps(ch.phaserPhase), _mm_mul_ps(_mm_setr_ps(0.f, 1.f, 2.f, 3.f), _mm_set1_ps(phaserStep)));
+            const __m128 step4 = _mm_set1_ps(step * 4.f);
+            const __m128 phaserStep4 = _mm_set1_ps(phaserStep * 4.f);
+            const __m128 gain = _mm_set1_ps(volume);
+
+            __m128i noise = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ch.noiseState));
+
+            for (int i = 0; i < count; i += 4)
+            {
+                __m128 wave = waveform4<t_waveform>(fract4(phase), fract4(phase2), noise);
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(wave, gain)));
+                phase = _mm_add_ps(phase, step4);
+                phase2 = _mm_add_ps(phase2, phaserStep4);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(ch.noiseState), noise);
+
+            ch.phase += step * count;
+            ch.phase -= std::floor(ch.phase);
+            ch.phaserPhase += phaserStep * count;
+            ch.phaserPhase -= std::floor(ch.phaserPhase);
+        }
+
+        typedef void (*generate_fn)(Channel&, float32*, int, float32, float32);
+
+        const generate_fn k_generators[8] = {
+            generate<k_waveTriangle>,
+            generate<k_waveTiltedSaw>,
+            generate<k_waveSaw>,
+            generate<k_waveSquare>,
+            generate<k_wavePulse>,
+            generate<k_waveOrgan>,
+            generate<k_waveNoise>,
+            generate<k_wavePhaser>,
+        };
+
+        void start_channel(Synth& self, int channel, int sfx, int offset, int length, bool fromMusic)
+        {
+            const byte* data = sfx_addr(self, sfx);
+
+            Channel& ch = self.channels[channel];
+            ch.sfx = sfx;
+            ch.note = std::clamp(offset, 0, k_sfxNoteCount - 1);
+            ch.noteSample = 0;
+            ch.endNote = std::min(ch.note + std::max(length, 1), sfx_length(data));
+            ch.fromMusic = fromMusic;
+            ch.lastFrequency = 0.f;
+            ch.lastVolume = 0.f;
+            ch.instrument = {};
+        }
+
+        void advance_note(Synth& self, Channel& ch)
+        {
+            const byte* data = sfx_addr(self, ch.sfx);
+            Note note = decode_note(data, ch.note);
+
+            // slides start from wherever the previous note ended up
+            ch.lastFrequency = pitch_frequency(note.pitch);
+            ch.lastVolume = note.volume / 7.f;
+            ch.noteSample = 0;
+            ch.note++;
+            ch.instrument = {};
+
+            if (sfx_loops(data) && ch.note >= sfx_loop_end(data))
+            {
+                ch.note = sfx_loop_start(data);
+            }
+            else if (ch.note >= ch.endNote)
+            {
+                ch.sfx = -1;
+            }
+        }
+
+        // frequency and volume of a note with its effect applied over the block starting sample into it
+        void apply_effect(const byte* data, int index, const Note& note, int sample, int n, float32 lastFrequency,
+            float32 lastVolume, float32& frequency, float32& volume)
+        {
+            const int speed = sfx_speed(data);
+            const int noteLength = speed * k_samplesPerTick;
+
+            // effects are sampled at the middle of the block
+            const float32 t = (sample + n * 0.5f) / noteLength;
+            const float32 seconds = static_cast<float32>(sample) / k_sampleRate;
+
+            frequency = pitch_frequency(note.pitch);
+            volume = note.volume / 7.f;
+
+            switch (note.effect)
+            {
+            case k_fxSlide:
+                if (lastFrequency > 0.f)
+                {
+                    frequency = lastFrequency + (frequency - lastFrequency) * t;
+                    volume = lastVolume + (volume - lastVolume) * t;
+                }
+                break;
+            case k_fxVibrato:
+                frequency *= std::pow(2.f, triangle01(seconds * 7.5f) * 0.25f / 12.f);
+                break;
+            case k_fxDrop:
+                frequency *= 1.f - t;
+                break;
+            case k_fxFadeIn:
+                volume *= t;
+                break;
+            case k_fxFadeOut:
+                volume *= 1.f - t;
+                break;
+            case k_fxArpFast:
+            case k_fxArpSlow:
+            {
+                // cycles through the group of 4 notes this note belongs to
+                int ticksPerStep = (note.effect == k_fxArpFast) ? 4 : 8;
+                if (speed <= 8)
+                {
+                    ticksPerStep /= 2;
+                }
+                int step = (sample / (k_samplesPerTick * ticksPerStep)) & 3;
+                frequency = pitch_frequency(decode_note(data, (index & ~3) + step).pitch);
+                break;
+            }
+            default: break;
+            }
+        }
+
+        // moves a custom note's instrument on n samples, it loops like any sfx or goes quiet once it runs out
+        void advance_instrument(Synth& self, Channel& ch, int instrument, int n)
+        {
+            const byte* data = sfx_addr(self, instrument);
+            ch.instrument.noteSample += n;
+            if (ch.instrument.noteSample < sfx_speed(data) * k_samplesPerTick)
+            {
+                return;
+            }
+
+            Note note = decode_note(data, ch.instrument.note);
+            ch.instrument.lastFrequency = pitch_frequency(note.pitch);
+            ch.instrument.lastVolume = note.volume / 7.f;
+            ch.instrument.noteSample = 0;
+            ch.instrument.note++;
+
+            if (sfx_loops(data) && ch.instrument.note >= sfx_loop_end(data))
+            {
+                ch.instrument.note = sfx_loop_start(data);
+            }
+            else if (ch.instrument.note >= sfx_length(data))
+            {
+                ch.instrument.note = -1;
+            }
+        }
+
+        // mixes up to count samples of a channel, stops early only if the channel finishes
+        void render_channel(Synth& self, Channel& ch, float32* out, int count, float32 gain)
+        {
+            alignas(16) float32 block[k_blockSize];
+
+            int written = 0;
+            while (written < count && ch.sfx >= 0)
+            {
+                const byte* data = sfx_addr(self, ch.sfx);
+                const int noteLength = sfx_speed(data) * k_samplesPerTick;
+                int n = std::min({ count - written, noteLength - ch.noteSample, k_blockSize });
+
+                Note note = decode_note(data, ch.note);
+
+                float32 frequency, volume;
+                int waveform = note.waveform;
+                bool audible = note.volume > 0;
+                if (audible)
+                {
+                    apply_effect(data, ch.note, note, ch.noteSample, n, ch.lastFrequency, ch.lastVolume, frequency, volume);
+                }
+
+                if (audible && note.custom)
+                {
+                    // the instrument's own notes play transposed to this note, under this note's volume and effect
+                    const byte* instrumentData = sfx_addr(self, note.waveform);
+                    audible = ch.instrument.note >= 0;
+                    if (audible)
+                    {
+                        n = std::min(n, sfx_speed(instrumentData) * k_samplesPerTick - ch.instrument.noteSample);
+
+                        Note instrumentNote = decode_note(instrumentData, ch.instrument.note);
+                        float32 instrumentFrequency, instrumentVolume;
+                        apply_effect(instrumentData, ch.instrument.note, instrumentNote, ch.instrument.noteSample, n,
+                            ch.instrument.lastFrequency, ch.instrument.lastVolume, instrumentFrequency, instrumentVolume);
+
+                        frequency *= instrumentFrequency / pitch_frequency(k_instrumentBasePitch);
+                        volume *= instrumentVolume;
+                        waveform = instrumentNote.waveform;
+                        audible = instrumentNote.volume > 0;
+                        advance_instrument(self, ch, note.waveform, n);
+                    }
+                }
+
+                if (audible)
+                {
+                    std::memset(block, 0, sizeof(block));
+                    k_generators[waveform](ch, block, n, frequency, volume * gain);
+
+                    if (waveform == k_waveNoise)
+                    {
+                        // higher pitches let more of the white noise through
+                        float32 cutoff = std::min(1.f, frequency / 2000.f);
+                        for (int i = 0; i < n; ++i)
+                        {
+                            ch.noiseLevel += (block[i] - ch.noiseLevel) * cutoff;
+                            block[i] = ch.noiseLevel;
+                        }
+                    }
+
+                    for (int i = 0; i < n; ++i)
+                    {
+                        out[written + i] += block[i];
+                    }
+                }
+
+                written += n;
+                ch.noteSample += n;
+
+                if (ch.noteSample >= noteLength)
+                {
+                    advance_note(self, ch);
+                }
+            }
+        }
+
+        void start_pattern(Synth& self, int pattern)
+        {
+            const byte* data = self.memory + k_offsetMusic + pattern * 4;
+
+            self.music.pattern = pattern;
+            self.music.patternSample = 0;
+            self.music.patternLength = 0;
+
+            if ((data[0] & 0x80) != 0)
+            {
+                self.music.loopStart = pattern;
+            }
+
+            int loopingLength = 0;
+            for (int i = 0; i < k_channelCount; ++i)
+            {
+                if ((self.music.channelMask & (1 << i)) == 0)
+                {
+                    continue;
+                }
+
+                Channel& ch = self.channels[i];
+                if ((data[i] & 0x40) != 0)
+                {
+                    // disabled channel, only silence what music itself was playing
+                    if (ch.fromMusic)
+                    {
+                        ch.sfx = -1;
+                    }
+                    continue;
+                }
+
+                int sfx = data[i] & 0x3F;
+                start_channel(self, i, sfx, 0, k_sfxNoteCount, true);
+
+                // the first non looping channel decides how long the pattern lasts
+                const byte* sfxData = sfx_addr(self, sfx);
+                int length = sfx_length(sfxData) * sfx_speed(sfxData) * k_samplesPerTick;
+                if (!sfx_loops(sfxData))
+                {
+                    if (self.music.patternLength == 0)
+                    {
+                        self.music.patternLength = length;
+                    }
+                }
+                else
+                {
+                    loopingLength = std::max(loopingLength, length);
+                }
+            }
+
+            if (self.music.patternLength == 0)
+            {
+                self.music.patternLength = std::max(loopingLength, k_samplesPerTick);
+            }
+        }
+
+        void advance_pattern(Synth& self)
+        {
+            const byte* data = self.memory + k_offsetMusic + self.music.pattern * 4;
+
+            if ((data[1] & 0x80) != 0)
+            {
+                start_pattern(self, self.music.loopStart);
+            }
+            else if ((data[2] & 0x80) != 0 || self.music.pattern + 1 >= k_musicPatternCount)
+            {
+                stop_music(self);
+            }
+            else
+            {
+                start_pattern(self, self.music.pattern + 1);
+            }
+        }
+
+        void init(Synth& self, const byte* memory)
+        {
+            self = Synth{};
+            self.memory = memory;
+
+            // decorrelate the noise generators between channels
+            for (int i = 0; i < k_channelCount; ++i)
+            {
+                for (uint32& state : self.channels[i].noiseState)
+                {
+                    state ^= static_cast<uint32>(i + 1) * 0x85EBCA6Bu;
+                }
+            }
+        }
+
+        void play_sfx(Synth& self, int sfx, int channel /* = -1 */, int offset /* = 0 */, int length /* = k_sfxNoteCount */)
+        {
+            if (sfx < 0)
+            {
+                stop_sfx(self, -1, channel);
+                return;
+            }
+
+            if (sfx >= k_sfxCount)
+            {
+                return;
+            }
+
+            if (channel < 0)
+            {
+                // prefer an idle channel, otherwise steal one music isn't using
+                for (int i = 0; i < k_channelCount && channel < 0; ++i)
+                {
+                    if (self.channels[i].sfx < 0)
+                    {
+                        channel = i;
+                    }
+                }
+                for (int i = 0; i < k_channelCount && channel < 0; ++i)
+                {
+                    if (!self.channels[i].fromMusic)
+                    {
+                        channel = i;
+                    }
+                }
+                if (channel < 0)
+                {
+                    channel = k_channelCount - 1;
+                }
+            }
+
+            if (channel >= k_channelCount)
+            {
+                return;
+            }
+
+            start_channel(self, channel, sfx, offset, length, false);
+        }
+
+        void stop_sfx(Synth& self, int sfx, int channel /* = -1 */)
+        {
+            for (int i = 0; i < k_channelCount; ++i)
+            {
+                Channel& ch = self.channels[i];
+                if ((channel < 0 || channel == i) && (sfx < 0 || ch.sfx == sfx))
+                {
+                    ch.sfx = -1;
+                }
+            }
+        }
+
+        void play_music(Synth& self, int pattern, int fadeMs /* = 0 */, int channelMask /* = 0xF */)
+        {
+            const float32 fadeRate = (fadeMs > 0) ? 1000.f / (static_cast<float32>(fadeMs) * k_sampleRate) : 0.f;
+
+            if (pattern < 0 || pattern >= k_musicPatternCount)
+            {
+                if (fadeRate > 0.f && self.music.pattern >= 0)
+                {
+                    self.music.fadeRate = -fadeRate;
+                }
+                else
+                {
+                    stop_music(self);
+                }
+                return;
+            }
+
+            self.music.channelMask = static_cast<uint8>((channelMask == 0) ? 0xF : channelMask);
+            self.music.loopStart = pattern;
+            self.music.volume = (fadeRate > 0.f) ? 0.f : 1.f;
+            self.music.fadeRate = fadeRate;
+            start_pattern(self, pattern);
+        }
+
+        void stop_music(Synth& self)
+        {
+            for (Channel& ch : self.channels)
+            {
+                if (ch.fromMusic)
+                {
+                    ch.sfx = -1;
+                }
+            }
+            self.music.pattern = -1;
+            self.music.volume = 1.f;
+            self.music.fadeRate = 0.f;
+        }
+
+        void render(Synth& self, float32* out, int sampleCount)
+        {
+            std::fill(out, out + sampleCount, 0.f);
+
+            int written = 0;
+            while (written < sampleCount)
+            {
+                int n = sampleCount - written;
+                if (self.music.pattern >= 0)
+                {
+                    n = std::min(n, self.music.patternLength - self.music.patternSample);
+                }
+                if (self.music.fadeRate != 0.f)
+                {
+                    // fades step once a block, fine enough not to zipper
+                    n = std::min(n, k_blockSize);
+                }
+
+                for (Channel& ch : self.channels)
+                {
+                    render_channel(self, ch, out + written, n, ch.fromMusic ? self.music.volume : 1.f);
+                }
+
+                written += n;
+
+                if (self.music.fadeRate != 0.f)
+                {
+                    self.music.volume += self.music.fadeRate * n;
+                    if (self.music.volume >= 1.f)
+                    {
+                        self.music.volume = 1.f;
+                        self.music.fadeRate = 0.f;
+                    }
+                    else if (self.music.volume <= 0.f)
+                    {
+                        stop_music(self);
+                    }
+                }
+
+                if (self.music.pattern >= 0)
+                {
+                    self.music.patternSample += n;
+                    if (self.music.patternSample >= self.music.patternLength)
+                    {
+                        advance_pattern(self);
+                    }
+                }
+            }
+
+            const float32 gain = self.masterVolume / k_channelCount;
+            for (int i = 0; i < sampleCount; ++i)
+            {
+                out[i] *= gain;
+            }
+        }
+
+        void to_pcm16(const float32* in, int16* out, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                float32 v = std::clamp(in[i], -1.f, 1.f);
+                out[i] = static_cast<int16>(v * 32767.f);
+            }
+        }
+
+        void render_wav(Synth& self, int sampleCount, std::vector<uint8>& out)
+        {
+            const uint32 dataBytes = static_cast<uint32>(sampleCount) * sizeof(int16);
+            const uint32 headerBytes = 44;
+
+            out.resize(headerBytes + dataBytes);
+            uint8* p = out.data();
+
+            auto write32 = [&p](uint32 v) { std::memcpy(p, &v, 4); p += 4; };
+            auto write16 = [&p](uint16 v) { std::memcpy(p, &v, 2); p += 2; };
+            auto writeTag = [&p](const char* tag) { std::memcpy(p, tag, 4); p += 4; };
+
+            writeTag("RIFF");
+            write32(headerBytes - 8 + dataBytes);
+            writeTag("WAVE");
+            writeTag("fmt ");
+            write32(16);
+            write16(1);
+            write16(1);
+            write32(k_sampleRate);
+            write32(k_sampleRate * sizeof(int16));
+            write16(sizeof(int16));
+            write16(16);
+            writeTag("data");
+            write32(dataBytes);
+
+            float32 block[k_blockSize * 4];
+            int16 pcm[k_blockSize * 4];
+
+            for (int i = 0; i < sampleCount; i += k_blockSize * 4)
+            {
+                int n = std::min(sampleCount - i, k_blockSize * 4);
+                render(self, block, n);
+                to_pcm16(block, pcm, n);
+                std::memcpy(p, pcm, n * sizeof(int16));
+                p += n * sizeof(int16);
+            }
+        }
+
+        void SDLCALL device_callback(void* userdata, Uint8* stream, int len)
+        {
+            int16* samples = reinterpret_cast<int16*>(stream);
+            const size_t count = static_cast<size_t>(len) / sizeof(int16);
+
+            int32 mix[k_blockSize * 4];
+            int16 voice[k_blockSize * 4];
+
+            for (size_t offset = 0; offset < count; offset += k_blockSize * 4)
+            {
+                const size_t n = std::min(count - offset, static_cast<size_t>(k_blockSize * 4));
+                std::fill(mix, mix + n, 0);
+
+                for (auto& v : s_device.voices)
+                {
+                    if (v.owner == nullptr)
+                    {
+                        continue;
+                    }
+
+                    size_t read = v.ring.pop(voice, n);
+                    if (read < n)
+                    {
+                        // never wait on the frame loop, the missing part of this voice is silence
+                        s_device.underruns.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    for (size_t i = 0; i < read; ++i)
+                    {
+                        mix[i] += voice[i];
+                    }
+                }
+
+                for (size_t i = 0; i < n; ++i)
+                {
+                    samples[offset + i] = static_cast<int16>(std::clamp(mix[i], -32768, 32767));
+                }
+            }
+        }
+
+        bool open_device(bool headless /* = false */)
+        {
+            if (s_device.device != 0)
+            {
+                return true;
+            }
+
+            if (headless)
+            {
+                SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+            }
+
+            if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+            {
+                printf("SDL Error: %s\n", SDL_GetError());
+                return false;
+            }
+
+            SDL_AudioSpec desired = {};
+            desired.freq = k_sampleRate;
+            desired.format = AUDIO_S16SYS;
+            desired.channels = 1;
+            desired.samples = 512;
+            desired.callback = device_callback;
+
+            SDL_AudioSpec obtained = {};
+            s_device.device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0);
+            if (s_device.device == 0)
+            {
+                printf("SDL Error: %s\n", SDL_GetError());
+                return false;
+            }
+
+            SDL_PauseAudioDevice(s_device.device, 0);
+            return true;
+        }
+
+        void close_device()
+        {
+            if (s_device.device != 0)
+            {
+                SDL_CloseAudioDevice(s_device.device);
+                s_device.device = 0;
+            }
+            SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        }
+
+        bool attach(Synth& self)
+        {
+            if (self.voice >= 0)
+            {
+                return true;
+            }
+
+            if (s_device.device != 0)
+            {
+                SDL_LockAudioDevice(s_device.device);
+            }
+
+            for (int i = 0; i < k_maxVoices && self.voice < 0; ++i)
+            {
+                if (s_device.voices[i].owner == nullptr)
+                {
+                    s_device.voices[i].ring.reset();
+                    s_device.voices[i].owner = &self;
+                    self.voice = i;
+                }
+            }
+
+            if (s_device.device != 0)
+            {
+                SDL_UnlockAudioDevice(s_device.device);
+            }
+
+            if (self.voice < 0)
+            {
+                printf("Audio Error: all %d voices are attached\n", k_maxVoices);
+                return false;
+            }
+            return true;
+        }
+
+        void detach(Synth& self)
+        {
+            if (self.voice < 0)
+            {
+                return;
+            }
+
+            if (s_device.device != 0)
+            {
+                SDL_LockAudioDevice(s_device.device);
+            }
+
+            s_device.voices[self.voice].owner = nullptr;
+            self.voice = -1;
+
+            if (s_device.device != 0)
+            {
+                SDL_UnlockAudioDevice(s_device.device);
+            }
+        }
+
+        void pump(Synth& self)
+        {
+            if (s_device.device == 0 || self.voice < 0)
+            {
+                return;
+            }
+
+            auto& ring = s_device.voices[self.voice].ring;
+
+            float32 block[k_blockSize * 4];
+            int16 pcm[k_blockSize * 4];
+
+            size_t queued = ring.size();
+            while (queued < k_targetLatency)
+            {
+                int n = static_cast<int>(std::min(k_targetLatency - queued, sizeof(pcm) / sizeof(int16)));
+                render(self, block, n);
+                to_pcm16(block, pcm, n);
+                queued += ring.push(pcm, n);
+            }
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "types.h"
+
+namespace pico8
+{
+    namespace audio
+    {
+        const int k_sampleRate = 22050;
+        const int k_channelCount = 4;
+        const int k_sfxCount = 64;
+        const int k_sfxSize = 68;
+        const int k_sfxNoteCount = 32;
+        const int k_musicPatternCount = 64;
+
+        // one sfx "speed" unit is 1/120th of a second at pico8's native rate
+        const int k_samplesPerTick = 183;
+
+        // samples are generated in fixed blocks so the oscillators stay in registers,
+        // effects (slides, vibrato, fades) are evaluated once per block
+        const int k_blockSize = 64;
+
+        // machines that can play through the device at once, each gets its own ring
+        const int k_maxVoices = 8;
+
+        // custom instruments (sfx 0-7) play their notes transposed by how far the note is from this pitch (C2)
+        const int k_instrumentBasePitch = 24;
+
+        // lock free single producer/single consumer ring buffer, capacity must be a power of 2
+        template <typename t_type, size_t t_capacity>
+        struct SpscRing
+        {
+            static_assert((t_capacity & (t_capacity - 1)) == 0, "SpscRing capacity must be a power of 2");
+            static const size_t k_mask = t_capacity - 1;
+
+            size_t size() const
+            {
+                return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+            }
+
+            size_t space() const
+            {
+                return t_capacity - size();
+            }
+
+            // only while neither side is running
+            void reset()
+            {
+                m_head.store(0, std::memory_order_relaxed);
+                m_tail.store(0, std::memory_order_relaxed);
+            }
+
+            // producer only, returns how many items were written
+            size_t push(const t_type* items, size_t count)
+            {
+                size_t head = m_head.load(std::memory_order_relaxed);
+                size_t tail = m_tail.load(std::memory_order_acquire);
+                count = std::min(count, t_capacity - (head - tail));
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    m_data[(head + i) & k_mask] = items[i];
+                }
+
+                m_head.store(head + count, std::memory_order_release);
+                return count;
+            }
+
+            // consumer only, returns how many items were read
+            size_t pop(t_type* items, size_t count)
+            {
+                size_t tail = m_tail.load(std::memory_order_relaxed);
+                size_t head = m_head.load(std::memory_order_acquire);
+                count = std::min(count, head - tail);
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    items[i] = m_data[(tail + i) & k_mask];
+                }
+
+                m_tail.store(tail + count, std::memory_order_release);
+                return count;
+            }
+
+        private:
+            // producer and consumer indices live on separate cache lines
+            alignas(64) std::atomic<size_t> m_head = 0;
+            alignas(64) std::atomic<size_t> m_tail = 0;
+            t_type m_data[t_capacity];
+        };
+
+        struct Channel
+        {
+            int sfx = -1;
+            int note = 0;
+            int noteSample = 0;
+            int endNote = k_sfxNoteCount;
+            bool fromMusic = false;
+
+            // where the instrument sfx of a custom note is up to, -1 once it has run out
+            struct
+            {
+                int note = 0;
+                int noteSample = 0;
+                float32 lastFrequency = 0.f;
+                float32 lastVolume = 0.f;
+            } instrument;
+
+            float32 phase = 0.f;
+            float32 phaserPhase = 0.f;
+            float32 lastFrequency = 0.f;
+            float32 lastVolume = 0.f;
+            float32 noiseLevel = 0.f;
+            uint32 noiseState[4] = { 0x9E3779B9, 0x7F4A7C15, 0x94D049BB, 0x2545F491 };
+        };
+
+        struct Synth
+        {
+            const byte* memory = nullptr;
+            Channel channels[k_channelCount];
+
+            struct
+            {
+                int pattern = -1;
+                int patternSample = 0;
+                int patternLength = 0;
+                int loopStart = 0;
+                uint8 channelMask = 0xF;
+                // music channels are scaled by volume, fades move it fadeRate per sample and a fade out stops
+                // the music when it reaches 0
+                float32 volume = 1.f;
+                float32 fadeRate = 0.f;
+            } music;
+
+            float32 masterVolume = 0.5f;
+
+            // device ring this synth feeds, see attach
+            int voice = -1;
+        };
+
+        // synth state only reads from memory, it never owns it so any number of machines can each run one
+        void init(Synth& self, const byte* memory);
+        void play_sfx(Synth& self, int sfx, int channel = -1, int offset = 0, int length = k_sfxNoteCount);
+        void stop_sfx(Synth& self, int sfx, int channel = -1);
+        // fadeMs fades a new pattern in, or with pattern -1 fades the current music out before stopping it
+        void play_music(Synth& self, int pattern, int fadeMs = 0, int channelMask = 0xF);
+        void stop_music(Synth& self);
+
+        // mixes sampleCount mono samples in [-1..1] into out, safe to call without any audio device
+        void render(Synth& self, float32* out, int sampleCount);
+
+        // renders sampleCount samples as a 16 bit mono RIFF/WAVE file into out
+        void render_wav(Synth& self, int sampleCount, std::vector<uint8>& out);
+
+        // opens the SDL audio device, headless forces SDL's dummy driver so offline rendering works anywhere.
+        // nothing opens it implicitly
+        bool open_device(bool headless = false);
+        void close_device();
+
+        // gives synth its own ring on the device, the callback mixes every attached ring so any number of
+        // machines (up to k_maxVoices) can play at once without starving each other
+        bool attach(Synth& self);
+        void detach(Synth& self);
+
+        // tops synth's ring up without blocking, called once per frame. does nothing for a detached synth
+        void pump(Synth& self);
+    }
+}
@@ -0,0 +1,531 @@
+#include "pico8_cart.h"
+
+#include <emmintrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include <stb/stb_image.h>
+
+#include "pico8.h"
+
+namespace pico8
+{
+    namespace cart
+    {
+        const size_t k_sfxSize = 68;
+        const size_t k_sfxCount = 64;
+
+        struct hex_table
+        {
+            int8 values[256];
+
+            constexpr hex_table() : values()
+            {
+                for (int i = 0; i < 256; ++i)
+                {
+                    values[i] = -1;
+                }
+                for (int i = 0; i < 10; ++i)
+                {
+                    values['0' + i] = static_cast<int8>(i);
+                }
+                for (int i = 0; i < 6; ++i)
+                {
+                    values['a' + i] = static_cast<int8>(10 + i);
+                    values['A' + i] = static_cast<int8>(10 + i);
+                }
+            }
+        };
+
+        constexpr hex_table k_hex;
+
+        inline uint8 hex_nibble(char c)
+        {
+            int8 v = k_hex.values[static_cast<uint8>(c)];
+            return static_cast<uint8>((v < 0) ? 0 : v);
+        }
+
+        inline uint8 hex_byte(const char* c)
+        {
+            return static_cast<uint8>((hex_nibble(c[0]) << 4) | hex_nibble(c[1]));
+        }
+
+        // walks the lines of a section, trimming any trailing \r
+        template <typename t_fn>
+        void for_each_line(std::string_view text, int maxLines, t_fn&& fn)
+        {
+            int line = 0;
+            while (!text.empty() && line < maxLines)
+            {
+                size_t end = text.find('\n');
+                std::string_view row = text.substr(0, end);
+                if (!row.empty() && row.back() == '\r')
+                {
+                    row.remove_suffix(1);
+                }
+
+                fn(line++, row);
+
+                if (end == std::string_view::npos)
+                {
+                    break;
+                }
+                text.remove_prefix(end + 1);
+            }
+        }
+
+        // pixels are one hex digit each, left pixel goes in the low nibble
+        void decode_gfx(std::string_view text, byte* memory)
+        {
+            for_each_line(text, 128, [memory](int y, std::string_view row)
+            {
+                byte* dest = memory + k_offsetSpriteSheet + y * 64;
+                size_t count = std::min<size_t>(row.size() / 2, 64);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    dest[i] = static_cast<byte>(hex_nibble(row[i * 2]) | (hex_nibble(row[i * 2 + 1]) << 4));
+                }
+            });
+        }
+
+        void decode_bytes(std::string_view text, byte* dest, int bytesPerLine, int maxLines)
+        {
+            for_each_line(text, maxLines, [dest, bytesPerLine](int y, std::string_view row)
+            {
+                byte* line = dest + y * bytesPerLine;
+                size_t count = std::min<size_t>(row.size() / 2, bytesPerLine);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    line[i] = hex_byte(&row[i * 2]);
+                }
+            });
+        }
+
+        // "eessllee" header then 32 notes of "ppwvf", packed into the 16 bit note format the synth plays
+        void decode_sfx(std::string_view text, byte* memory)
+        {
+            for_each_line(text, k_sfxCount, [memory](int n, std::string_view row)
+            {
+                if (row.size() < 168)
+                {
+                    return;
+                }
+
+                byte* sfx = memory + k_offsetSfx + n * k_sfxSize;
+                for (int i = 0; i < 4; ++i)
+                {
+                    sfx[64 + i] = hex_byte(&row[i * 2]);
+                }
+
+                const char* note = &row[8];
+                for (int i = 0; i < 32; ++i, note += 5)
+                {
+                    uint32 pitch = hex_byte(note);
+                    uint32 wave = hex_nibble(note[2]);
+                    uint32 volume = hex_nibble(note[3]);
+                    uint32 effect = hex_nibble(note[4]);
+
+                    uint32 bits = (pitch & 0x3F) | ((wave & 0x7) << 6) | ((volume & 0x7) << 9) |
+                        ((effect & 0x7) << 12) | ((wave & 0x8) << 12);
+
+                    sfx[i * 2] = static_cast<byte>(bits);
+                    sfx[i * 2 + 1] = static_cast<byte>(bits >> 8);
+                }
+            });
+        }
+
+        // "ff aabbccdd", flag bits 0-2 (loop start, loop end, stop) become bit 7 of the first three channels
+        void decode_music(std::string_view text, byte* memory)
+        {
+            for_each_line(text, 64, [memory](int n, std::string_view row)
+            {
+                if (row.size() < 11)
+                {
+                    return;
+                }
+
+                uint8 flags = hex_byte(&row[0]);
+                byte* pattern = memory + k_offsetMusic + n * 4;
+                for (int i = 0; i < 4; ++i)
+                {
+                    pattern[i] = static_cast<byte>((hex_byte(&row[3 + i * 2]) & 0x7F) | (((flags >> i) & 1) << 7));
+                }
+            });
+        }
+
+        bool try_load_p8(const char* text, size_t length, byte* memory, Cart& out)
+        {
+            std::string_view source(text, length);
+            if (source.substr(0, 64).find("pico-8 cartridge") == std::string_view::npos)
+            {
+                printf("Not a pico-8 cartridge.\n");
+                return false;
+            }
+
+            // split into sections first so each one can decode on its own thread
+            struct section
+            {
+                std::string_view name;
+                std::string_view body;
+            };
+            std::vector<section> sections;
+
+            size_t pos = 0;
+            while (pos < source.size())
+            {
+                size_t end = source.find('\n', pos);
+                if (end == std::string_view::npos)
+                {
+                    end = source.size();
+                }
+
+                std::string_view line = source.substr(pos, end - pos);
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.remove_suffix(1);
+                }
+
+                if (line.size() > 4 && line.compare(0, 2, "__") == 0 && line.compare(line.size() - 2, 2, "__") == 0)
+                {
+                    if (!sections.empty())
+                    {
+                        section& last = sections.back();
+                        last.body = source.substr(last.body.data() - source.data(), pos - (last.body.data() - source.data()));
+                    }
+                    sections.push_back({ line.substr(2, line.size() - 4), source.substr(std::min(end + 1, source.size())) });
+                }
+                else if (sections.empty() && line.compare(0, 8, "version ") == 0)
+                {
+                    out.version = std::atoi(line.data() + 8);
+                }
+
+                pos = end + 1;
+            }
+
+            std::memset(memory, 0, k_romSize);
+            out.code.clear();
+
+            std::vector<std::future<void>> jobs;
+            for (const section& s : sections)
+            {
+                std::string_view body = s.body;
+                if (s.name == "lua")
+                {
+                    out.code.assign(body.data(), body.size());
+                }
+                else if (s.name == "gfx")
+                {
+                    jobs.push_back(std::async(std::launch::async, decode_gfx, body, memory));
+                }
+                else if (s.name == "gff")
+                {
+                    jobs.push_back(std::async(std::launch::async, decode_bytes, body, memory + k_offsetSpriteFlags, 128, 2));
+                }
+                else if (s.name == "map")
+                {
+                    jobs.push_back(std::async(std::launch::async, decode_bytes, body, memory + k_offsetMap, 128, 32));
+                }
+                else if (s.name == "sfx")
+                {
+                    jobs.push_back(std::async(std::launch::async, decode_sfx, body, memory));
+                }
+                else if (s.name == "music")
+                {
+                    jobs.push_back(std::async(std::launch::async, decode_music, body, memory));
+                }
+            }
+
+            for (std::future<void>& job : jobs)
+            {
+                job.get();
+            }
+
+            return true;
+        }
+
+        // each pixel carries one byte, 2 bits per channel packed as argb
+        void decode_png_bytes(const uint8* rgba, byte* dest, size_t count)
+        {
+            size_t i = 0;
+
+            const __m128i mask = _mm_set1_epi32(0x03030303);
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i packed[4];
+                for (int j = 0; j < 4; ++j)
+                {
+                    __m128i px = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + (i + j * 4) * 4)), mask);
+
+                    // r << 4 | g << 2 | b | a << 6 in the low byte of each lane
+                    __m128i r = _mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0xFF)), 4);
+                    __m128i g = _mm_and_si128(_mm_srli_epi32(px, 6), _mm_set1_epi32(0x0C));
+                    __m128i b = _mm_and_si128(_mm_srli_epi32(px, 16), _mm_set1_epi32(0x03));
+                    __m128i a = _mm_slli_epi32(_mm_srli_epi32(px, 24), 6);
+                    packed[j] = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+                }
+
+                __m128i lo = _mm_packs_epi32(packed[0], packed[1]);
+                __m128i hi = _mm_packs_epi32(packed[2], packed[3]);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packus_epi16(lo, hi));
+            }
+
+            for (; i < count; ++i)
+            {
+                const uint8* px = rgba + i * 4;
+                dest[i] = static_cast<byte>(((px[3] & 3) << 6) | ((px[0] & 3) << 4) | ((px[1] & 3) << 2) | (px[2] & 3));
+            }
+        }
+
+        bool try_load_png_pixels(const uint8* rgba, byte* memory, Cart& out)
+        {
+            const size_t codeOffset = k_romSize * 4;
+
+            // rom goes straight into memory while the code half decodes and decompresses on another thread
+            auto codeJob = std::async(std::launch::async, [rgba, codeOffset, &out]()
+            {
+                byte code[k_codeSize + 1];
+                decode_png_bytes(rgba + codeOffset, code, k_codeSize + 1);
+                out.version = code[k_codeSize];
+                return try_decompress_code(code, k_codeSize, out.code);
+            });
+
+            decode_png_bytes(rgba, memory, k_romSize);
+
+            return codeJob.get();
+        }
+
+        bool try_load_png(const char* filename, byte* memory, Cart& out)
+        {
+            int w, h, n;
+            uint8* rgba = stbi_load(filename, &w, &h, &n, 4);
+            if (rgba == nullptr)
+            {
+                printf("Failed to load cartridge image %s.\n", filename);
+                return false;
+            }
+
+            bool result = false;
+            if (w == k_pngWidth && h == k_pngHeight)
+            {
+                result = try_load_png_pixels(rgba, memory, out);
+            }
+            else
+            {
+                printf("Cartridge image %s is %dx%d, expected %dx%d.\n", filename, w, h, k_pngWidth, k_pngHeight);
+            }
+
+            stbi_image_free(rgba);
+            return result;
+        }
+
+        bool try_load(const char* filename, byte* memory, Cart& out)
+        {
+            std::string_view name(filename);
+            if (name.size() >= 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+            {
+                return try_load_png(filename, memory, out);
+            }
+
+            std::ifstream file(filename, std::ios::binary);
+            if (!file)
+            {
+                printf("Failed to open cartridge %s.\n", filename);
+                return false;
+            }
+
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+            std::string text = buffer.str();
+
+            return try_load_p8(text.data(), text.size(), memory, out);
+        }
+
+        // reads the pxa bitstream lsb first
+        struct bit_reader
+        {
+            const byte* data;
+            size_t size;
+            size_t bit = 0;
+
+            inline uint32 get_bit()
+            {
+                size_t index = bit >> 3;
+                uint32 value = (index < size) ? ((data[index] >> (bit & 7)) & 1) : 0;
+                ++bit;
+                return value;
+            }
+
+            inline uint32 get_bits(int count)
+            {
+                uint32 value = 0;
+                for (int i = 0; i < count; ++i)
+                {
+                    value |= get_bit() << i;
+                }
+                return value;
+            }
+
+            inline bool exhausted() const { return (bit >> 3) >= size; }
+        };
+
+        bool decompress_pxa(const byte* data, size_t size, std::string& out)
+        {
+            if (size < 8)
+            {
+                return false;
+            }
+
+            size_t length = (data[4] << 8) | data[5];
+            size_t compressedLength = std::min<size_t>((data[6] << 8) | data[7], size);
+
+            bit_reader reader{ data + 8, compressedLength - std::min<size_t>(compressedLength, 8) };
+
+            uint8 mtf[256];
+            for (int i = 0; i < 256; ++i)
+            {
+                mtf[i] = static_cast<uint8>(i);
+            }
+
+            out.clear();
+            out.reserve(length);
+
+            while (out.size() < length && !reader.exhausted())
+            {
+                if (reader.get_bit() != 0)
+                {
+                    // move to front coded literal
+                    int bits = 4;
+                    while (reader.get_bit() != 0 && bits < 8)
+                    {
+                        ++bits;
+                    }
+
+                    uint32 index = reader.get_bits(bits) + (1u << bits) - 16;
+                    if (index > 255)
+                    {
+                        return false;
+                    }
+
+                    uint8 c = mtf[index];
+                    std::memmove(mtf + 1, mtf, index);
+                    mtf[0] = c;
+                    out.push_back(static_cast<char>(c));
+                }
+                else
+                {
+                    int bits = (reader.get_bit() != 0) ? ((reader.get_bit() != 0) ? 5 : 10) : 15;
+                    size_t offset = reader.get_bits(bits) + 1;
+
+                    if (bits == 10 && offset == 1)
+                    {
+                        // uncompressed run, zero terminated
+                        uint32 c;
+                        while ((c = reader.get_bits(8)) != 0 && out.size() < length)
+                        {
+                            out.push_back(static_cast<char>(c));
+                        }
+                        continue;
+                    }
+
+                    size_t count = 3;
+                    uint32 part;
+                    do
+                    {
+                        part = reader.get_bits(3);
+                        count += part;
+                    } while (part == 7);
+
+                    if (offset > out.size())
+                    {
+                        return false;
+                    }
+
+                    // byte at a time, the copy is allowed to overlap what it's writing
+                    size_t from = out.size() - offset;
+                    for (size_t i = 0; i < count && out.size() < length; ++i)
+                    {
+                        out.push_back(out[from + i]);
+                    }
+                }
+            }
+
+            return out.size() == length;
+        }
+
+        bool decompress_legacy(const byte* data, size_t size, std::string& out)
+        {
+            static const char k_chars[] = "\n 0123456789abcdefghijklmnopqrstuvwxyz!#%(){}[]<>+=/*:;.,~_";
+
+            if (size < 8)
+            {
+                return false;
+            }
+
+            size_t length = (data[4] << 8) | data[5];
+
+            out.clear();
+            out.reserve(length);
+
+            for (size_t i = 8; i < size && out.size() < length; ++i)
+            {
+                uint8 b = data[i];
+                if (b == 0x00)
+                {
+                    if (++i < size)
+                    {
+                        out.push_back(static_cast<char>(data[i]));
+                    }
+                }
+                else if (b < 0x3c)
+                {
+                    out.push_back(k_chars[b - 1]);
+                }
+                else
+                {
+                    if (++i >= size)
+                    {
+                        return false;
+                    }
+
+                    size_t offset = (b - 0x3c) * 16 + (data[i] & 0xF);
+                    size_t count = (data[i] >> 4) + 2;
+                    if (offset == 0 || offset > out.size())
+                    {
+                        return false;
+                    }
+
+                    size_t from = out.size() - offset;
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        out.push_back(out[from + j]);
+                    }
+                }
+            }
+
+            return out.size() == length;
+        }
+
+        bool try_decompress_code(const byte* data, size_t size, std::string& out)
+        {
+            if (size >= 4 && std::memcmp(data, "\0pxa", 4) == 0)
+            {
+                return decompress_pxa(data, size, out);
+            }
+
+            if (size >= 4 && std::memcmp(data, ":c:\0", 4) == 0)
+            {
+                return decompress_legacy(data, size, out);
+            }
+
+            const byte* end = static_cast<const byte*>(std::memchr(data, 0, size));
+            out.assign(reinterpret_cast<const char*>(data), (end != nullptr) ? end - data : size);
+            return true;
+        }
+    }
+}
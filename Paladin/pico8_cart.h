@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "types.h"
+
+// loads pico8 cartridges, both the text .p8 format and the .p8.png image format, straight into machine memory.
+// the 0x4300 bytes of cart rom (gfx, map, flags, music, sfx) are written at the same offsets they live at in
+// memory, the lua source comes back separately since there is nowhere in memory for it to go.
+
+namespace pico8
+{
+    namespace cart
+    {
+        const size_t k_romSize = 0x4300;
+        const size_t k_codeSize = 0x3d00;
+
+        const int k_pngWidth = 160;
+        const int k_pngHeight = 205;
+
+        struct Cart
+        {
+            std::string code;
+            int version = 0;
+        };
+
+        // picks the format from the file extension, memory must be at least k_romSize bytes
+        bool try_load(const char* filename, byte* memory, Cart& out);
+
+        bool try_load_p8(const char* text, size_t length, byte* memory, Cart& out);
+        bool try_load_png(const char* filename, byte* memory, Cart& out);
+
+        // rom and code packed into the low 2 bits of each rgba pixel, rgba must be k_pngWidth * k_pngHeight pixels
+        bool try_load_png_pixels(const uint8* rgba, byte* memory, Cart& out);
+
+        // code section as stored in a png cart, plain text, legacy ":c:" or pxa compressed
+        bool try_decompress_code(const byte* data, size_t size, std::string& out);
+    }
+}
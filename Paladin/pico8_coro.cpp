@@ -0,0 +1,118 @@
+#include "pico8_coro.h"
+
+#include <cstdio>
+
+namespace pico8
+{
+    namespace co
+    {
+        static FramePool* s_pool = nullptr;
+        static Script* s_running = nullptr;
+        static fixed16 s_now = 0;
+
+        void init_pool(FramePool& self)
+        {
+            self.freeList = nullptr;
+            self.used = 0;
+
+            for (int i = k_frameSlotCount - 1; i >= 0; --i)
+            {
+                self.slots[i].next = self.freeList;
+                self.freeList = &self.slots[i];
+            }
+        }
+
+        void* pool_alloc(FramePool& self, size_t size)
+        {
+            if (size > k_frameSlotSize)
+            {
+                printf("Coroutine frame of %zu bytes is larger than a pool slot (%zu).\n", size, k_frameSlotSize);
+                return nullptr;
+            }
+
+            if (self.freeList == nullptr)
+            {
+                printf("Coroutine frame pool exhausted (%d frames).\n", k_frameSlotCount);
+                return nullptr;
+            }
+
+            FramePool::Slot* slot = self.freeList;
+            self.freeList = slot->next;
+            ++self.used;
+            return slot->storage;
+        }
+
+        void pool_free(FramePool& self, void* ptr)
+        {
+            FramePool::Slot* slot = static_cast<FramePool::Slot*>(ptr);
+            slot->next = self.freeList;
+            self.freeList = slot;
+            --self.used;
+        }
+
+        void bind_pool(FramePool* pool)
+        {
+            s_pool = pool;
+        }
+
+        void* Task::promise_type::operator new(size_t size) noexcept
+        {
+            return (s_pool != nullptr) ? pool_alloc(*s_pool, size) : nullptr;
+        }
+
+        void Task::promise_type::operator delete(void* ptr) noexcept
+        {
+            pool_free(*s_pool, ptr);
+        }
+
+        void wait_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            // the innermost script is the one that gets resumed, it hands back to its callers as it finishes
+            s_running->resumePoint = h;
+            s_running->wakeTime = s_now + duration;
+        }
+
+        void run(Script& self, Task (*fn)(), fixed16 now)
+        {
+            if (fn == nullptr)
+            {
+                return;
+            }
+
+            std::coroutine_handle<> next = self.resumePoint;
+            if (next)
+            {
+                if (now < self.wakeTime)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                self.task = fn();
+                if (!self.task.valid())
+                {
+                    return;
+                }
+                next = self.task.handle;
+            }
+
+            self.resumePoint = nullptr;
+
+            Script* previous = s_running;
+            s_running = &self;
+            s_now = now;
+
+            next.resume();
+
+            s_running = previous;
+
+            // ran off the end without waiting, frees the frames now rather than on the next run
+            if (self.task.done())
+            {
+                self.task.reset();
+                self.resumePoint = nullptr;
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+#include "pico8.h"
+
+// coroutine carts. update and draw can be written as straight line scripts that co_await co::flip() to
+// end the frame or co_await co::sleep(t) to wait, the machine picks them up where they left off.
+// frames come out of a fixed pool owned by the machine so nothing touches the heap once a cart is running.
+
+namespace pico8
+{
+    namespace co
+    {
+        const size_t k_frameSlotSize = 1024;
+        const int k_frameSlotCount = 64;
+
+        struct FramePool
+        {
+            union Slot
+            {
+                Slot* next;
+                alignas(std::max_align_t) byte storage[k_frameSlotSize];
+            };
+
+            Slot slots[k_frameSlotCount];
+            Slot* freeList = nullptr;
+            int used = 0;
+        };
+
+        void init_pool(FramePool& self);
+        void* pool_alloc(FramePool& self, size_t size);
+        void pool_free(FramePool& self, void* ptr);
+
+        // pool new coroutine frames come from, set by the machine before it runs any cart code
+        void bind_pool(FramePool* pool);
+
+        struct Task
+        {
+            struct promise_type;
+            using handle_type = std::coroutine_handle<promise_type>;
+
+            // once a nested task finishes control goes straight back to whatever awaited it
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(handle_type h) noexcept
+                {
+                    std::coroutine_handle<> continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() const noexcept {}
+            };
+
+            struct promise_type
+            {
+                std::coroutine_handle<> continuation;
+
+                Task get_return_object() { return Task(handle_type::from_promise(*this)); }
+                static Task get_return_object_on_allocation_failure() { return Task(); }
+
+                std::suspend_always initial_suspend() noexcept { return {}; }
+                final_awaiter final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+
+                static void* operator new(size_t size) noexcept;
+                static void operator delete(void* ptr) noexcept;
+            };
+
+            struct awaiter
+            {
+                handle_type handle;
+
+                bool await_ready() const noexcept { return !handle || handle.done(); }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept
+                {
+                    handle.promise().continuation = h;
+                    return handle;
+                }
+                void await_resume() const noexcept {}
+            };
+
+            Task() = default;
+            explicit Task(handle_type h) : handle(h) {}
+            Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+            Task& operator=(Task&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    reset();
+                    handle = other.handle;
+                    other.handle = nullptr;
+                }
+                return *this;
+            }
+            Task(const Task&) = delete;
+            Task& operator=(const Task&) = delete;
+            ~Task() { reset(); }
+
+            void reset()
+            {
+                if (handle)
+                {
+                    handle.destroy();
+                    handle = nullptr;
+                }
+            }
+
+            inline bool valid() const { return static_cast<bool>(handle); }
+            inline bool done() const { return !handle || handle.done(); }
+
+            // awaiting a task runs it to completion as part of the caller's script
+            awaiter operator co_await() && noexcept { return awaiter{ handle }; }
+
+            handle_type handle = nullptr;
+        };
+
+        // where a machine script is parked and when it should carry on
+        struct Script
+        {
+            Task task;
+            std::coroutine_handle<> resumePoint;
+            fixed16 wakeTime = 0;
+        };
+
+        // starts a new run of fn if the last one finished, otherwise resumes it once its wait is over
+        void run(Script& self, Task (*fn)(), fixed16 now);
+
+        struct wait_awaiter
+        {
+            fixed16 duration;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) noexcept;
+            void await_resume() const noexcept {}
+        };
+
+        // ends the frame, the script carries on next frame
+        inline wait_awaiter flip() { return wait_awaiter{ 0 }; }
+
+        // the script carries on once the machine clock has moved on by seconds
+        inline wait_awaiter sleep(fixed16 seconds) { return wait_awaiter{ seconds }; }
+    }
+
+    typedef co::Task (*pico8_script)(void);
+
+    void system_init(pico8_callback initFn, pico8_script updateFn, pico8_script drawFn);
+}
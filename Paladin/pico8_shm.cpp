@@ -0,0 +1,224 @@
+#include "pico8_shm.h"
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace pico8
+{
+    namespace shm
+    {
+        size_t page_size()
+        {
+#ifdef _WIN32
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        byte* allocate_pages(size_t size)
+        {
+#ifdef _WIN32
+            return static_cast<byte*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+            void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return (addr == MAP_FAILED) ? nullptr : static_cast<byte*>(addr);
+#endif
+        }
+
+        void* map_segment(const char* name, size_t size, bool create, void*& handle)
+        {
+#ifdef _WIN32
+            HANDLE mapping = nullptr;
+            if (create)
+            {
+                mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                    0, static_cast<DWORD>(size), name);
+            }
+            else
+            {
+                mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+            }
+
+            if (mapping == nullptr)
+            {
+                printf("Failed to map shared memory '%s' (%lu).\n", name, GetLastError());
+                return nullptr;
+            }
+
+            void* addr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+            if (addr == nullptr)
+            {
+                CloseHandle(mapping);
+                return nullptr;
+            }
+
+            handle = mapping;
+            return addr;
+#else
+            // posix names need a leading slash, e.g. "/paladin"
+            int fd = shm_open(name, create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+            if (fd < 0)
+            {
+                printf("Failed to map shared memory '%s'.\n", name);
+                return nullptr;
+            }
+
+            if (create && ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                ::close(fd);
+                return nullptr;
+            }
+
+            void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+
+            if (addr == MAP_FAILED)
+            {
+                return nullptr;
+            }
+
+            handle = nullptr;
+            return addr;
+#endif
+        }
+
+        void unmap_segment(void* addr, size_t size, void* handle)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(addr);
+            CloseHandle(static_cast<HANDLE>(handle));
+#else
+            munmap(addr, size);
+#endif
+        }
+
+        bool create(const char* name, size_t memorySize, View& out)
+        {
+            const size_t headerSize = page_size();
+            size_t size = headerSize + memorySize;
+
+            void* handle = nullptr;
+            void* addr = map_segment(name, size, true, handle);
+            if (addr == nullptr)
+            {
+                return false;
+            }
+
+            Header* header = new (addr) Header();
+            header->magic = k_magic;
+            header->version = k_version;
+            header->headerSize = static_cast<uint32>(headerSize);
+            header->memorySize = static_cast<uint32>(memorySize);
+            header->sequence.store(0, std::memory_order_relaxed);
+            header->frame.store(0, std::memory_order_relaxed);
+
+            out.header = header;
+            out.memory = static_cast<byte*>(addr) + headerSize;
+            out.size = size;
+            out.handle = handle;
+
+            std::memset(out.memory, 0, memorySize);
+            return true;
+        }
+
+        void destroy(View& self, const char* name)
+        {
+            close(self);
+#ifndef _WIN32
+            shm_unlink(name);
+#endif
+        }
+
+        // both ends are idempotent so a frame cut short by sleep() can close the window from either side
+        void begin_frame(View& self)
+        {
+            if (self.header == nullptr)
+            {
+                return;
+            }
+
+            uint32 sequence = self.header->sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) != 0)
+            {
+                return;
+            }
+
+            self.header->sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void end_frame(View& self)
+        {
+            if (self.header == nullptr)
+            {
+                return;
+            }
+
+            uint32 sequence = self.header->sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) == 0)
+            {
+                return;
+            }
+
+            self.header->frame.fetch_add(1, std::memory_order_relaxed);
+            self.header->sequence.store(sequence + 1, std::memory_order_release);
+        }
+
+        bool open(const char* name, View& out)
+        {
+            void* handle = nullptr;
+            // the creator's page size decides where memory starts, just the header is enough to find out
+            void* addr = map_segment(name, sizeof(Header), false, handle);
+            if (addr == nullptr)
+            {
+                return false;
+            }
+
+            Header* header = static_cast<Header*>(addr);
+            if (header->magic != k_magic || header->version != k_version)
+            {
+                unmap_segment(addr, sizeof(Header), handle);
+                return false;
+            }
+
+            // remap now that we know how big the machine memory is
+            size_t size = header->headerSize + header->memorySize;
+            size_t headerSize = header->headerSize;
+            unmap_segment(addr, sizeof(Header), handle);
+
+            addr = map_segment(name, size, false, handle);
+            if (addr == nullptr)
+            {
+                return false;
+            }
+
+            out.header = static_cast<Header*>(addr);
+            out.memory = static_cast<byte*>(addr) + headerSize;
+            out.size = size;
+            out.handle = handle;
+            return true;
+        }
+
+        void close(View& self)
+        {
+            if (self.header != nullptr)
+            {
+                unmap_segment(self.header, self.size, self.handle);
+            }
+            self = View{};
+        }
+    }
+}
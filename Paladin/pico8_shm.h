@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "types.h"
+
+// shared memory view of a pico8 machine, external tools (memory viewers, profilers, bots) map the
+// same segment and read the live 32k of machine memory directly without the console pausing
+
+namespace pico8
+{
+    namespace shm
+    {
+        const uint32 k_magic = 0x4D533850; // "P8SM"
+        const uint32 k_version = 1;
+
+        // how often read_consistent retries before deciding the machine died mid frame
+        const int k_readAttempts = 100000;
+
+        struct Header
+        {
+            uint32 magic;
+            uint32 version;
+            uint32 headerSize;
+            uint32 memorySize;
+
+            // seqlock, odd while the machine is inside update/draw
+            std::atomic<uint32> sequence;
+            uint32 reserved;
+            std::atomic<uint64> frame;
+        };
+
+        // header gets a page of its own so machine memory stays page aligned
+        size_t page_size();
+
+        // page aligned memory for a machine that isn't shared, never freed
+        byte* allocate_pages(size_t size);
+
+        struct View
+        {
+            Header* header = nullptr;
+            byte* memory = nullptr;
+            size_t size = 0;
+            void* handle = nullptr;
+        };
+
+        // machine side, creates the named segment and returns a view whose memory the machine runs out of
+        bool create(const char* name, size_t memorySize, View& out);
+        void destroy(View& self, const char* name);
+
+        void begin_frame(View& self);
+        void end_frame(View& self);
+
+        // tool side, maps an existing segment created by another process
+        bool open(const char* name, View& out);
+        void close(View& self);
+
+        // calls fn(memory) until it ran against a frame the machine wasn't writing to and stores that frame's
+        // number. gives up after attempts tries, e.g. when the machine died mid frame and the sequence stays odd.
+        // fn should only read what it needs, everything it reads may be torn until the sequence check passes
+        template <typename t_fn>
+        bool read_consistent(const View& self, t_fn&& fn, uint64& frame, int attempts = k_readAttempts)
+        {
+            for (int i = 0; i < attempts; ++i)
+            {
+                uint32 begin = self.header->sequence.load(std::memory_order_acquire);
+                if ((begin & 1) != 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                uint64 beginFrame = self.header->frame.load(std::memory_order_relaxed);
+                fn(static_cast<const byte*>(self.memory));
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (self.header->sequence.load(std::memory_order_relaxed) == begin)
+                {
+                    frame = beginFrame;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+}
@@ -0,0 +1,438 @@
+#include "pico8_watch.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "imgui.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PICO8_WATCH_SINGLE_STEP
+#endif
+
+namespace pico8
+{
+    namespace watch
+    {
+        const uint32 k_trapFlag = 0x100;
+
+        static struct
+        {
+            byte* memory = nullptr;
+            size_t size = 0;
+            size_t pageSize = 0x1000;
+            bool handlersInstalled = false;
+
+            Watchpoint watchpoints[k_maxWatchpoints] = {};
+            Hit hits[k_maxHits] = {};
+            uint32 totalHits = 0;
+            uint64 frame = 0;
+
+            // the write currently being single stepped through an unlocked page
+            byte* pendingPage = nullptr;
+            int pendingHit = -1;
+
+            // pages left unlocked because the cpu can't single step, re-locked on the next frame
+            bool dirty = false;
+
+#ifndef _WIN32
+            struct sigaction previousSegv;
+            struct sigaction previousTrap;
+#endif
+        } s_watch;
+
+        bool is_page_watched(size_t page)
+        {
+            size_t pageStart = page * s_watch.pageSize;
+            size_t pageEnd = pageStart + s_watch.pageSize;
+
+            for (const Watchpoint& w : s_watch.watchpoints)
+            {
+                if (w.active && w.address < pageEnd && w.address + w.size > pageStart)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void protect_page(size_t page, bool readOnly)
+        {
+            byte* addr = s_watch.memory + page * s_watch.pageSize;
+#ifdef _WIN32
+            DWORD old;
+            VirtualProtect(addr, s_watch.pageSize, readOnly ? PAGE_READONLY : PAGE_READWRITE, &old);
+#else
+            mprotect(addr, s_watch.pageSize, readOnly ? PROT_READ : (PROT_READ | PROT_WRITE));
+#endif
+        }
+
+        void protect_all()
+        {
+            if (s_watch.memory == nullptr)
+            {
+                return;
+            }
+
+            size_t pageCount = s_watch.size / s_watch.pageSize;
+            for (size_t page = 0; page < pageCount; ++page)
+            {
+                protect_page(page, is_page_watched(page));
+            }
+            s_watch.dirty = false;
+        }
+
+        void unprotect_all()
+        {
+            if (s_watch.memory == nullptr)
+            {
+                return;
+            }
+
+            size_t pageCount = s_watch.size / s_watch.pageSize;
+            for (size_t page = 0; page < pageCount; ++page)
+            {
+                protect_page(page, false);
+            }
+        }
+
+        // runs inside the fault handler, so no allocation and no locks
+        bool on_write_fault(byte* addr, uintptr_t pc)
+        {
+            if (s_watch.memory == nullptr || addr < s_watch.memory || addr >= s_watch.memory + s_watch.size)
+            {
+                return false;
+            }
+
+            uint32 address = static_cast<uint32>(addr - s_watch.memory);
+            size_t page = address / s_watch.pageSize;
+
+            s_watch.pendingHit = -1;
+            for (int i = 0; i < k_maxWatchpoints; ++i)
+            {
+                Watchpoint& w = s_watch.watchpoints[i];
+                if (w.active && address >= w.address && address < w.address + w.size)
+                {
+                    w.hits++;
+
+                    int slot = static_cast<int>(s_watch.totalHits % k_maxHits);
+                    s_watch.hits[slot] = Hit{ s_watch.frame, pc, address, i, *addr, *addr };
+                    s_watch.totalHits++;
+                    s_watch.pendingHit = slot;
+                    break;
+                }
+            }
+
+            s_watch.pendingPage = s_watch.memory + page * s_watch.pageSize;
+            protect_page(page, false);
+            return true;
+        }
+
+        bool on_single_step()
+        {
+            if (s_watch.pendingPage == nullptr)
+            {
+                return false;
+            }
+
+            if (s_watch.pendingHit >= 0)
+            {
+                Hit& hit = s_watch.hits[s_watch.pendingHit];
+                hit.after = s_watch.memory[hit.address];
+            }
+
+            size_t page = static_cast<size_t>(s_watch.pendingPage - s_watch.memory) / s_watch.pageSize;
+            protect_page(page, is_page_watched(page));
+
+            s_watch.pendingPage = nullptr;
+            s_watch.pendingHit = -1;
+            return true;
+        }
+
+#ifdef _WIN32
+        LONG CALLBACK exception_handler(EXCEPTION_POINTERS* info)
+        {
+            EXCEPTION_RECORD* record = info->ExceptionRecord;
+            CONTEXT* context = info->ContextRecord;
+
+            if (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && record->ExceptionInformation[0] == 1)
+            {
+                byte* addr = reinterpret_cast<byte*>(record->ExceptionInformation[1]);
+                if (on_write_fault(addr, reinterpret_cast<uintptr_t>(record->ExceptionAddress)))
+                {
+#ifdef PICO8_WATCH_SINGLE_STEP
+                    context->EFlags |= k_trapFlag;
+#else
+                    s_watch.dirty = true;
+#endif
+                    return EXCEPTION_CONTINUE_EXECUTION;
+                }
+            }
+            else if (record->ExceptionCode == EXCEPTION_SINGLE_STEP)
+            {
+                if (on_single_step())
+                {
+                    return EXCEPTION_CONTINUE_EXECUTION;
+                }
+            }
+
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+
+        void install_handlers()
+        {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            s_watch.pageSize = info.dwPageSize;
+
+            AddVectoredExceptionHandler(1, exception_handler);
+        }
+#else
+#if defined(__x86_64__)
+        inline uintptr_t context_pc(void* context)
+        {
+            return static_cast<uintptr_t>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+        }
+
+        inline void set_trap_flag(void* context, bool enabled)
+        {
+            greg_t& flags = static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL];
+            flags = enabled ? (flags | k_trapFlag) : (flags & ~static_cast<greg_t>(k_trapFlag));
+        }
+#elif defined(__i386__)
+        inline uintptr_t context_pc(void* context)
+        {
+            return static_cast<uintptr_t>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EIP]);
+        }
+
+        inline void set_trap_flag(void* context, bool enabled)
+        {
+            greg_t& flags = static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL];
+            flags = enabled ? (flags | k_trapFlag) : (flags & ~static_cast<greg_t>(k_trapFlag));
+        }
+#else
+        inline uintptr_t context_pc(void* context) { return 0; }
+        inline void set_trap_flag(void* context, bool enabled) {}
+#endif
+
+        void chain(const struct sigaction& previous, int sig, siginfo_t* info, void* context)
+        {
+            if ((previous.sa_flags & SA_SIGINFO) != 0 && previous.sa_sigaction != nullptr)
+            {
+                previous.sa_sigaction(sig, info, context);
+            }
+            else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+            {
+                previous.sa_handler(sig);
+            }
+            else if (previous.sa_handler == SIG_DFL)
+            {
+                // not ours, take the default action now rather than returning into the same fault
+                signal(sig, SIG_DFL);
+                raise(sig);
+            }
+        }
+
+        void segv_handler(int sig, siginfo_t* info, void* context)
+        {
+            // only permission faults from the cpu can be ours, not unmapped addresses or a kill(SIGSEGV)
+            if (info->si_code == SEGV_ACCERR && on_write_fault(static_cast<byte*>(info->si_addr), context_pc(context)))
+            {
+#ifdef PICO8_WATCH_SINGLE_STEP
+                set_trap_flag(context, true);
+#else
+                s_watch.dirty = true;
+#endif
+                return;
+            }
+            chain(s_watch.previousSegv, sig, info, context);
+        }
+
+        void trap_handler(int sig, siginfo_t* info, void* context)
+        {
+            if (info->si_code == TRAP_TRACE && on_single_step())
+            {
+                set_trap_flag(context, false);
+                return;
+            }
+            chain(s_watch.previousTrap, sig, info, context);
+        }
+
+        void install_handlers()
+        {
+            s_watch.pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+            struct sigaction action = {};
+            action.sa_flags = SA_SIGINFO;
+            sigemptyset(&action.sa_mask);
+
+            action.sa_sigaction = segv_handler;
+            sigaction(SIGSEGV, &action, &s_watch.previousSegv);
+
+#ifdef PICO8_WATCH_SINGLE_STEP
+            action.sa_sigaction = trap_handler;
+            sigaction(SIGTRAP, &action, &s_watch.previousTrap);
+#endif
+        }
+#endif
+
+        void attach(byte* memory, size_t size)
+        {
+            if (!s_watch.handlersInstalled)
+            {
+                install_handlers();
+                s_watch.handlersInstalled = true;
+            }
+
+            unprotect_all();
+
+            s_watch.memory = memory;
+            s_watch.size = size;
+
+            protect_all();
+        }
+
+        void detach()
+        {
+            unprotect_all();
+            s_watch.memory = nullptr;
+            s_watch.size = 0;
+        }
+
+        void next_frame()
+        {
+            s_watch.frame++;
+
+            if (s_watch.dirty)
+            {
+                protect_all();
+            }
+        }
+
+        int add(uint32 address, uint32 size, const char* label /* = nullptr */)
+        {
+            for (int i = 0; i < k_maxWatchpoints; ++i)
+            {
+                Watchpoint& w = s_watch.watchpoints[i];
+                if (!w.active)
+                {
+                    w = Watchpoint{ address, (size > 0) ? size : 1, {}, 0, true };
+                    snprintf(w.label, k_labelLength, "%s", (label != nullptr) ? label : "");
+                    protect_all();
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        void remove(int id)
+        {
+            if (id >= 0 && id < k_maxWatchpoints)
+            {
+                s_watch.watchpoints[id].active = false;
+                protect_all();
+            }
+        }
+
+        void clear()
+        {
+            for (Watchpoint& w : s_watch.watchpoints)
+            {
+                w.active = false;
+            }
+            protect_all();
+        }
+
+        int hit_count()
+        {
+            return static_cast<int>((s_watch.totalHits < k_maxHits) ? s_watch.totalHits : k_maxHits);
+        }
+
+        // 0 is the oldest hit still in the log
+        const Hit& get_hit(int index)
+        {
+            uint32 first = (s_watch.totalHits < k_maxHits) ? 0 : s_watch.totalHits - k_maxHits;
+            return s_watch.hits[(first + index) % k_maxHits];
+        }
+
+        const Watchpoint& get_watchpoint(int id)
+        {
+            return s_watch.watchpoints[id];
+        }
+
+        void clear_hits()
+        {
+            s_watch.totalHits = 0;
+            for (Watchpoint& w : s_watch.watchpoints)
+            {
+                w.hits = 0;
+            }
+        }
+
+        void draw_debug_ui()
+        {
+            if (!ImGui::CollapsingHeader("Pico8 Watchpoints"))
+            {
+                return;
+            }
+
+            static uint32 s_newAddress = 0x5f00;
+            static uint32 s_newSize = 1;
+            static char s_newLabel[k_labelLength] = "";
+
+            ImGui::InputScalar("Address", ImGuiDataType_U32, &s_newAddress, nullptr, nullptr, "%04X", ImGuiInputTextFlags_CharsHexadecimal);
+            ImGui::InputScalar("Size", ImGuiDataType_U32, &s_newSize);
+            ImGui::InputText("Label", s_newLabel, k_labelLength);
+
+            if (ImGui::Button("Add Watchpoint") && s_newAddress < s_watch.size)
+            {
+                add(s_newAddress, s_newSize, s_newLabel);
+            }
+
+            for (int i = 0; i < k_maxWatchpoints; ++i)
+            {
+                const Watchpoint& w = s_watch.watchpoints[i];
+                if (!w.active)
+                {
+                    continue;
+                }
+
+                ImGui::PushID(i);
+                if (ImGui::SmallButton("x"))
+                {
+                    remove(i);
+                }
+                ImGui::SameLine();
+                ImGui::Text("%04X+%u %s (%u hits)", w.address, w.size, w.label, w.hits);
+                ImGui::PopID();
+            }
+
+            ImGui::Separator();
+            ImGui::Text("Hits: %u", s_watch.totalHits);
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Clear"))
+            {
+                clear_hits();
+            }
+
+            ImGui::BeginChild("hits", ImVec2(0, 160), true);
+            for (int i = hit_count() - 1; i >= 0; --i)
+            {
+                const Hit& hit = get_hit(i);
+                ImGui::Text("f%llu  %04X  %02X -> %02X  %s  pc %p",
+                    static_cast<unsigned long long>(hit.frame), hit.address, hit.before, hit.after,
+                    s_watch.watchpoints[hit.watchpoint].label, reinterpret_cast<void*>(hit.pc));
+            }
+            ImGui::EndChild();
+        }
+    }
+}
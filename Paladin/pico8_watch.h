@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.h"
+
+// write watchpoints on pico8 machine memory. watched pages are made read only, the fault handler logs
+// the write, lets the instruction through with the page unlocked and re-locks it right after, so code
+// that never touches a watched page pays nothing. unwatched bytes sharing a page with a watchpoint still
+// take the fault, they just don't get logged.
+
+namespace pico8
+{
+    namespace watch
+    {
+        const int k_maxWatchpoints = 16;
+        const int k_maxHits = 256;
+        const int k_labelLength = 32;
+
+        struct Watchpoint
+        {
+            uint32 address;
+            uint32 size;
+            char label[k_labelLength];
+            uint32 hits;
+            bool active;
+        };
+
+        struct Hit
+        {
+            uint64 frame;
+            uintptr_t pc;
+            uint32 address;
+            int watchpoint;
+            uint8 before;
+            uint8 after;
+        };
+
+        // memory has to be page aligned, called again whenever the machine memory moves
+        void attach(byte* memory, size_t size);
+        void detach();
+
+        // once per machine frame, stamps hits with a frame number
+        void next_frame();
+
+        int add(uint32 address, uint32 size, const char* label = nullptr);
+        void remove(int id);
+        void clear();
+
+        int hit_count();
+        const Hit& get_hit(int index);
+        const Watchpoint& get_watchpoint(int id);
+        void clear_hits();
+
+        // watchpoint editor and hit log, drawn into whatever imgui window is current
+        void draw_debug_ui();
+    }
+}
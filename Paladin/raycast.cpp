@@ -0,0 +1,554 @@
+#include "raycast.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <stb/stb_image.h>
+
+#include "tdjx_gfx.h"
+#include "tdjx_jobs.h"
+#include "tdjx_simd.h"
+
+namespace tdjx
+{
+    namespace raycast
+    {
+        // a 4 byte gather at the last cell reads 3 past it
+        const int kGatherPadding = 3;
+
+        // columns per job, a few simd groups each
+        const int kColumnGrain = 64;
+
+        namespace grid
+        {
+            Grid create(int width, int height)
+            {
+                Grid result;
+                if (width <= 0 || height <= 0 || width > kMaxGridSize || height > kMaxGridSize)
+                {
+                    printf("Grid size %dx%d is outside 1..%d.\n", width, height, kMaxGridSize);
+                    return result;
+                }
+
+                result.width = width;
+                result.height = height;
+                result.cells.assign(width * height, 0);
+                result.occupancy.assign((width * height + 31) / 32, 0);
+                result.distance.assign(width * height + kGatherPadding, static_cast<uint8>(kMaxDistance));
+                return result;
+            }
+
+            Grid create_from_string(const char* data, int width, int height)
+            {
+                Grid result = create(width, height);
+                for (int y = 0; y < result.height; ++y)
+                {
+                    for (int x = 0; x < result.width; ++x)
+                    {
+                        char c = data[x + y * width];
+                        set_cell(result, x, y, (c == ' ') ? 0 : static_cast<uint8>(c));
+                    }
+                }
+                update_distance(result);
+                return result;
+            }
+
+            bool try_load_from_image(const char* filename, Grid& out)
+            {
+                int width, height, channels;
+                uint8* data = stbi_load(filename, &width, &height, &channels, 4);
+                if (!data)
+                {
+                    printf("Failed to load map '%s'.\n", filename);
+                    return false;
+                }
+
+                Grid result = create(width, height);
+                bool success = result.width > 0;
+                for (int i = 0; success && i < width * height; ++i)
+                {
+                    const uint8* pixel = data + i * 4;
+                    if (pixel[3] == 0)
+                    {
+                        continue;
+                    }
+
+                    int index = gfx::query_palette_index(pixel[0], pixel[1], pixel[2]);
+                    if (index < 0)
+                    {
+                        printf("Map '%s' has a colour that isn't in the palette at %d, %d.\n", filename, i % width, i / width);
+                        success = false;
+                    }
+                    else
+                    {
+                        set_cell(result, i % width, i / width, static_cast<uint8>(index));
+                    }
+                }
+
+                stbi_image_free(data);
+
+                if (success)
+                {
+                    update_distance(result);
+                    out = std::move(result);
+                }
+                return success;
+            }
+
+            uint8 get_cell(const Grid& self, int x, int y)
+            {
+                if (x < 0 || x >= self.width || y < 0 || y >= self.height)
+                {
+                    return 0;
+                }
+                return self.cells[x + y * self.width];
+            }
+
+            void set_cell(Grid& self, int x, int y, uint8 value)
+            {
+                if (x < 0 || x >= self.width || y < 0 || y >= self.height)
+                {
+                    return;
+                }
+
+                int index = x + y * self.width;
+                self.cells[index] = value;
+                if (value != 0)
+                {
+                    self.occupancy[index >> 5] |= 1u << (index & 31);
+                }
+                else
+                {
+                    self.occupancy[index >> 5] &= ~(1u << (index & 31));
+                }
+            }
+
+            void update_distance(Grid& self)
+            {
+                // two chamfer passes where all 8 neighbours are one step away, which is exactly chebyshev distance
+                int width = self.width, height = self.height;
+                uint8* distance = self.distance.data();
+                for (int i = 0; i < width * height; ++i)
+                {
+                    distance[i] = (self.cells[i] != 0) ? 0 : static_cast<uint8>(kMaxDistance);
+                }
+
+                auto relax = [&](int nx, int ny, int& best)
+                {
+                    if (nx >= 0 && nx < width && ny >= 0 && ny < height)
+                    {
+                        best = std::min(best, distance[nx + ny * width] + 1);
+                    }
+                };
+
+                for (int y = 0; y < height; ++y)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        int best = distance[x + y * width];
+                        relax(x - 1, y, best);
+                        relax(x - 1, y - 1, best);
+                        relax(x, y - 1, best);
+                        relax(x + 1, y - 1, best);
+                        distance[x + y * width] = static_cast<uint8>(std::min(best, kMaxDistance));
+                    }
+                }
+
+                for (int y = height - 1; y >= 0; --y)
+                {
+                    for (int x = width - 1; x >= 0; --x)
+                    {
+                        int best = distance[x + y * width];
+                        relax(x + 1, y, best);
+                        relax(x + 1, y + 1, best);
+                        relax(x, y + 1, best);
+                        relax(x - 1, y + 1, best);
+                        distance[x + y * width] = static_cast<uint8>(std::min(best, kMaxDistance));
+                    }
+                }
+            }
+
+            bool is_solid(const Grid& self, int x, int y)
+            {
+                int index = x + y * self.width;
+                return (self.occupancy[index >> 5] >> (index & 31)) & 1;
+            }
+        }
+
+        // where the walk for one ray stands, shared by the scalar and simd paths so both finish the same way
+        struct RayState
+        {
+            float32 sideX, sideY;
+            float32 deltaX, deltaY;
+            int32 x, y;
+            int32 side;
+        };
+
+        // distance along the ray to the next grid line either way out of the current cell
+        void set_side_distances(RayState& ray, float32 ox, float32 oy, float32 dx, float32 dy)
+        {
+            ray.sideX = (dx < 0) ? (ox - static_cast<float32>(ray.x)) * ray.deltaX : (static_cast<float32>(ray.x) + 1.0f - ox) * ray.deltaX;
+            ray.sideY = (dy < 0) ? (oy - static_cast<float32>(ray.y)) * ray.deltaY : (static_cast<float32>(ray.y) + 1.0f - oy) * ray.deltaY;
+        }
+
+        void begin_ray(float32 ox, float32 oy, float32 dx, float32 dy, RayState& ray)
+        {
+            ray.x = static_cast<int32>(std::floor(ox));
+            ray.y = static_cast<int32>(std::floor(oy));
+            ray.side = 0;
+
+            // a ray parallel to an axis never crosses those grid lines, the huge step keeps it from ever picking them
+            ray.deltaX = (dx != 0) ? std::abs(1.0f / dx) : kMiss;
+            ray.deltaY = (dy != 0) ? std::abs(1.0f / dy) : kMiss;
+
+            set_side_distances(ray, ox, oy, dx, dy);
+        }
+
+        // the open square reaching r cells out from the ray's cell can be crossed in one go. the ray moves to the
+        // last cell inside it, the next step then crosses out of the square like any other
+        void jump(RayState& ray, int32 r, float32 ox, float32 oy, float32 dx, float32 dy)
+        {
+            float32 edgeX = (dx < 0) ? static_cast<float32>(ray.x - r) : static_cast<float32>(ray.x + r + 1);
+            float32 edgeY = (dy < 0) ? static_cast<float32>(ray.y - r) : static_cast<float32>(ray.y + r + 1);
+            float32 tx = (dx < 0) ? (ox - edgeX) * ray.deltaX : (edgeX - ox) * ray.deltaX;
+            float32 ty = (dy < 0) ? (oy - edgeY) * ray.deltaY : (edgeY - oy) * ray.deltaY;
+
+            int32 x, y;
+            if (tx < ty)
+            {
+                x = (dx < 0) ? ray.x - r : ray.x + r;
+                y = std::clamp(static_cast<int32>(std::floor(oy + tx * dy)), ray.y - r, ray.y + r);
+            }
+            else
+            {
+                x = std::clamp(static_cast<int32>(std::floor(ox + ty * dx)), ray.x - r, ray.x + r);
+                y = (dy < 0) ? ray.y - r : ray.y + r;
+            }
+
+            ray.x = x;
+            ray.y = y;
+            set_side_distances(ray, ox, oy, dx, dy);
+
+            // rounding near a corner of the square can land a cell ahead of the ray on one axis, the walk would cut
+            // the corner from there and could step past a wall. a cell on the ray is entered on both axes before
+            // it's left on either, so one that isn't gets backed up a cell (it's still inside the square)
+            if (ray.sideX - ray.deltaX > ray.sideY)
+            {
+                ray.x -= (dx < 0) ? -1 : 1;
+                set_side_distances(ray, ox, oy, dx, dy);
+            }
+            else if (ray.sideY - ray.deltaY > ray.sideX)
+            {
+                ray.y -= (dy < 0) ? -1 : 1;
+                set_side_distances(ray, ox, oy, dx, dy);
+            }
+        }
+
+        void finish_ray(const RayState& ray, float32 ox, float32 oy, float32 dx, float32 dy,
+            float32& distance, int& side, int& cellX, int& cellY, float32& u)
+        {
+            // the side distance has already moved on past the line that was crossed
+            distance = (ray.side == 0) ? ray.sideX - ray.deltaX : ray.sideY - ray.deltaY;
+            side = ray.side;
+            cellX = ray.x;
+            cellY = ray.y;
+
+            float32 along = (ray.side == 0) ? oy + distance * dy : ox + distance * dx;
+            u = along - std::floor(along);
+        }
+
+        void miss(float32& distance, int& side, int& cellX, int& cellY, float32& u)
+        {
+            distance = kMiss;
+            side = 0;
+            cellX = -1;
+            cellY = -1;
+            u = 0;
+        }
+
+        bool cast(const Grid& grid, float32 ox, float32 oy, float32 dx, float32 dy,
+            float32& distance, int& side, int& cellX, int& cellY, float32& u)
+        {
+            RayState ray;
+            begin_ray(ox, oy, dx, dy, ray);
+
+            if (ray.x < 0 || ray.x >= grid.width || ray.y < 0 || ray.y >= grid.height)
+            {
+                miss(distance, side, cellX, cellY, u);
+                return false;
+            }
+
+            // starting inside a wall
+            if (grid::is_solid(grid, ray.x, ray.y))
+            {
+                distance = 0;
+                side = 0;
+                cellX = ray.x;
+                cellY = ray.y;
+                u = 0;
+                return true;
+            }
+
+            int32 stepX = (dx < 0) ? -1 : 1;
+            int32 stepY = (dy < 0) ? -1 : 1;
+
+            while (true)
+            {
+                int32 open = grid.distance[ray.x + ray.y * grid.width];
+                if (open > 1)
+                {
+                    jump(ray, open - 1, ox, oy, dx, dy);
+                }
+
+                if (ray.sideX < ray.sideY)
+                {
+                    ray.sideX += ray.deltaX;
+                    ray.x += stepX;
+                    ray.side = 0;
+                }
+                else
+                {
+                    ray.sideY += ray.deltaY;
+                    ray.y += stepY;
+                    ray.side = 1;
+                }
+
+                if (ray.x < 0 || ray.x >= grid.width || ray.y < 0 || ray.y >= grid.height)
+                {
+                    miss(distance, side, cellX, cellY, u);
+                    return false;
+                }
+
+                if (grid::is_solid(grid, ray.x, ray.y))
+                {
+                    break;
+                }
+            }
+
+            finish_ray(ray, ox, oy, dx, dy, distance, side, cellX, cellY, u);
+            return true;
+        }
+
+        void get_column_direction(float32 dirX, float32 dirY, float32 planeX, float32 planeY, int column, int count,
+            float32& dx, float32& dy)
+        {
+            float32 c = static_cast<float32>(2 * column + 1) / count - 1.0f;
+            dx = dirX + planeX * c;
+            dy = dirY + planeY * c;
+        }
+
+        void store_hit(Hits& out, int column, float32 distance, int side, int cellX, int cellY, float32 u)
+        {
+            out.distance[column] = distance;
+            out.side[column] = static_cast<uint8>(side);
+            out.cellX[column] = cellX;
+            out.cellY[column] = cellY;
+            out.u[column] = u;
+        }
+
+        // set_side_distances for 8 lanes
+        TDJX_TARGET_AVX2
+        static void set_side_distances_avx2(__m256i x, __m256i y, __m256 ox, __m256 oy, __m256 deltaX, __m256 deltaY,
+            __m256 negX, __m256 negY, __m256& sideX, __m256& sideY)
+        {
+            __m256 fx = _mm256_cvtepi32_ps(x);
+            __m256 fy = _mm256_cvtepi32_ps(y);
+            sideX = _mm256_blendv_ps(
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(fx, _mm256_set1_ps(1.0f)), ox), deltaX),
+                _mm256_mul_ps(_mm256_sub_ps(ox, fx), deltaX), negX);
+            sideY = _mm256_blendv_ps(
+                _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(fy, _mm256_set1_ps(1.0f)), oy), deltaY),
+                _mm256_mul_ps(_mm256_sub_ps(oy, fy), deltaY), negY);
+        }
+
+        // 8 columns in lockstep. every lane takes the same steps in the same order as cast so the results match it
+        TDJX_TARGET_AVX2
+        static void cast_group_avx2(const Grid& grid, float32 ox, float32 oy, const float32* dxs, const float32* dys,
+            Hits& out, int column)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+            const __m256i one = _mm256_set1_epi32(1);
+
+            __m256 dx = _mm256_loadu_ps(dxs);
+            __m256 dy = _mm256_loadu_ps(dys);
+
+            // every lane starts in the same cell, the caller has already checked it's empty and inside the grid
+            int32 startX = static_cast<int32>(std::floor(ox));
+            int32 startY = static_cast<int32>(std::floor(oy));
+            __m256i x = _mm256_set1_epi32(startX);
+            __m256i y = _mm256_set1_epi32(startY);
+            __m256 vox = _mm256_set1_ps(ox);
+            __m256 voy = _mm256_set1_ps(oy);
+
+            __m256 negX = _mm256_cmp_ps(dx, zero, _CMP_LT_OQ);
+            __m256 negY = _mm256_cmp_ps(dy, zero, _CMP_LT_OQ);
+
+            __m256 deltaX = _mm256_blendv_ps(_mm256_set1_ps(kMiss),
+                _mm256_andnot_ps(signMask, _mm256_div_ps(_mm256_set1_ps(1.0f), dx)), _mm256_cmp_ps(dx, zero, _CMP_NEQ_UQ));
+            __m256 deltaY = _mm256_blendv_ps(_mm256_set1_ps(kMiss),
+                _mm256_andnot_ps(signMask, _mm256_div_ps(_mm256_set1_ps(1.0f), dy)), _mm256_cmp_ps(dy, zero, _CMP_NEQ_UQ));
+
+            __m256 sideX, sideY;
+            set_side_distances_avx2(x, y, vox, voy, deltaX, deltaY, negX, negY, sideX, sideY);
+
+            __m256i stepX = _mm256_blendv_epi8(one, _mm256_set1_epi32(-1), _mm256_castps_si256(negX));
+            __m256i stepY = _mm256_blendv_epi8(one, _mm256_set1_epi32(-1), _mm256_castps_si256(negY));
+
+            const __m256i width = _mm256_set1_epi32(grid.width);
+            const __m256i height = _mm256_set1_epi32(grid.height);
+            const __m256i minusOne = _mm256_set1_epi32(-1);
+            const __m256i byteMask = _mm256_set1_epi32(0xff);
+            const __m256i bitMask = _mm256_set1_epi32(31);
+            const int* distances = reinterpret_cast<const int*>(grid.distance.data());
+            const int* occupancy = reinterpret_cast<const int*>(grid.occupancy.data());
+
+            __m256i side = _mm256_setzero_si256();
+            __m256i active = minusOne;
+            __m256i missed = _mm256_setzero_si256();
+
+            while (!_mm256_testz_si256(active, active))
+            {
+                // lanes with open ground around them jump across it the same way jump does
+                __m256i open = _mm256_and_si256(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), distances,
+                    _mm256_add_epi32(_mm256_mullo_epi32(y, width), x), active, 1), byteMask);
+                __m256i jumping = _mm256_and_si256(_mm256_cmpgt_epi32(open, one), active);
+                if (!_mm256_testz_si256(jumping, jumping))
+                {
+                    __m256i r = _mm256_sub_epi32(open, one);
+                    __m256i lowX = _mm256_sub_epi32(x, r), highX = _mm256_add_epi32(x, r);
+                    __m256i lowY = _mm256_sub_epi32(y, r), highY = _mm256_add_epi32(y, r);
+
+                    __m256 edgeX = _mm256_blendv_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(highX, one)), _mm256_cvtepi32_ps(lowX), negX);
+                    __m256 edgeY = _mm256_blendv_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(highY, one)), _mm256_cvtepi32_ps(lowY), negY);
+                    __m256 tx = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(edgeX, vox), _mm256_sub_ps(vox, edgeX), negX), deltaX);
+                    __m256 ty = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(edgeY, voy), _mm256_sub_ps(voy, edgeY), negY), deltaY);
+                    __m256i acrossX = _mm256_castps_si256(_mm256_cmp_ps(tx, ty, _CMP_LT_OQ));
+
+                    __m256i exitX = _mm256_blendv_epi8(highX, lowX, _mm256_castps_si256(negX));
+                    __m256i exitY = _mm256_blendv_epi8(highY, lowY, _mm256_castps_si256(negY));
+                    __m256i alongY = _mm256_min_epi32(_mm256_max_epi32(
+                        _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(voy, _mm256_mul_ps(tx, dy)))), lowY), highY);
+                    __m256i alongX = _mm256_min_epi32(_mm256_max_epi32(
+                        _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(vox, _mm256_mul_ps(ty, dx)))), lowX), highX);
+
+                    x = _mm256_blendv_epi8(x, _mm256_blendv_epi8(alongX, exitX, acrossX), jumping);
+                    y = _mm256_blendv_epi8(y, _mm256_blendv_epi8(exitY, alongY, acrossX), jumping);
+
+                    __m256 jumpedX, jumpedY;
+                    set_side_distances_avx2(x, y, vox, voy, deltaX, deltaY, negX, negY, jumpedX, jumpedY);
+
+                    // back up a landing cell the ray doesn't pass through, as jump does
+                    __m256i aheadX = _mm256_and_si256(jumping,
+                        _mm256_castps_si256(_mm256_cmp_ps(_mm256_sub_ps(jumpedX, deltaX), jumpedY, _CMP_GT_OQ)));
+                    __m256i aheadY = _mm256_andnot_si256(aheadX, _mm256_and_si256(jumping,
+                        _mm256_castps_si256(_mm256_cmp_ps(_mm256_sub_ps(jumpedY, deltaY), jumpedX, _CMP_GT_OQ))));
+                    __m256i ahead = _mm256_or_si256(aheadX, aheadY);
+                    if (!_mm256_testz_si256(ahead, ahead))
+                    {
+                        x = _mm256_sub_epi32(x, _mm256_and_si256(stepX, aheadX));
+                        y = _mm256_sub_epi32(y, _mm256_and_si256(stepY, aheadY));
+                        set_side_distances_avx2(x, y, vox, voy, deltaX, deltaY, negX, negY, jumpedX, jumpedY);
+                    }
+
+                    sideX = _mm256_blendv_ps(sideX, jumpedX, _mm256_castsi256_ps(jumping));
+                    sideY = _mm256_blendv_ps(sideY, jumpedY, _mm256_castsi256_ps(jumping));
+                }
+
+                __m256i takeX = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(sideX, sideY, _CMP_LT_OQ)), active);
+                __m256i takeY = _mm256_andnot_si256(takeX, active);
+
+                sideX = _mm256_add_ps(sideX, _mm256_and_ps(deltaX, _mm256_castsi256_ps(takeX)));
+                sideY = _mm256_add_ps(sideY, _mm256_and_ps(deltaY, _mm256_castsi256_ps(takeY)));
+                x = _mm256_add_epi32(x, _mm256_and_si256(stepX, takeX));
+                y = _mm256_add_epi32(y, _mm256_and_si256(stepY, takeY));
+                side = _mm256_blendv_epi8(side, _mm256_and_si256(takeY, one), active);
+
+                __m256i inside = _mm256_and_si256(
+                    _mm256_and_si256(_mm256_cmpgt_epi32(x, minusOne), _mm256_cmpgt_epi32(width, x)),
+                    _mm256_and_si256(_mm256_cmpgt_epi32(y, minusOne), _mm256_cmpgt_epi32(height, y)));
+
+                missed = _mm256_or_si256(missed, _mm256_andnot_si256(inside, active));
+                active = _mm256_and_si256(active, inside);
+
+                __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(y, width), x);
+                __m256i word = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), occupancy, _mm256_srli_epi32(index, 5), active, 4);
+                __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(index, bitMask)), one);
+                __m256i solid = _mm256_and_si256(_mm256_cmpeq_epi32(bit, one), active);
+                active = _mm256_andnot_si256(solid, active);
+            }
+
+            alignas(32) float32 sideXs[8], sideYs[8], deltaXs[8], deltaYs[8];
+            alignas(32) int32 xs[8], ys[8], sides[8], misses[8];
+            _mm256_store_ps(sideXs, sideX);
+            _mm256_store_ps(sideYs, sideY);
+            _mm256_store_ps(deltaXs, deltaX);
+            _mm256_store_ps(deltaYs, deltaY);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(xs), x);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(ys), y);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(sides), side);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(misses), missed);
+
+            for (int lane = 0; lane < 8; ++lane)
+            {
+                float32 distance, u;
+                int hitSide, cellX, cellY;
+                if (misses[lane])
+                {
+                    miss(distance, hitSide, cellX, cellY, u);
+                }
+                else
+                {
+                    RayState ray = { sideXs[lane], sideYs[lane], deltaXs[lane], deltaYs[lane], xs[lane], ys[lane], sides[lane] };
+                    finish_ray(ray, ox, oy, dxs[lane], dys[lane], distance, hitSide, cellX, cellY, u);
+                }
+                store_hit(out, column + lane, distance, hitSide, cellX, cellY, u);
+            }
+        }
+
+        void cast_columns(const Grid& grid, float32 ox, float32 oy, float32 dirX, float32 dirY,
+            float32 planeX, float32 planeY, int count, Hits& out)
+        {
+            out.distance.resize(count);
+            out.side.resize(count);
+            out.cellX.resize(count);
+            out.cellY.resize(count);
+            out.u.resize(count);
+
+            // standing outside the grid or inside a wall every column gets the same answer
+            int32 startX = static_cast<int32>(std::floor(ox));
+            int32 startY = static_cast<int32>(std::floor(oy));
+            bool open = startX >= 0 && startX < grid.width && startY >= 0 && startY < grid.height &&
+                !grid::is_solid(grid, startX, startY);
+
+            bool useAvx2 = open && util::cpu_has_avx2();
+
+            jobs::parallel_for(0, count, kColumnGrain, [&](int begin, int end)
+            {
+                int column = begin;
+                if (useAvx2)
+                {
+                    for (; column + 8 <= end; column += 8)
+                    {
+                        alignas(32) float32 dxs[8], dys[8];
+                        for (int lane = 0; lane < 8; ++lane)
+                        {
+                            get_column_direction(dirX, dirY, planeX, planeY, column + lane, count, dxs[lane], dys[lane]);
+                        }
+                        cast_group_avx2(grid, ox, oy, dxs, dys, out, column);
+                    }
+                }
+
+                for (; column < end; ++column)
+                {
+                    float32 dx, dy, distance, u;
+                    int side, cellX, cellY;
+                    get_column_direction(dirX, dirY, planeX, planeY, column, count, dx, dy);
+                    cast(grid, ox, oy, dx, dy, distance, side, cellX, cellY, u);
+                    store_hit(out, column, distance, side, cellX, cellY, u);
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+// grid raycasting for wolfenstein style walls. every column of the screen casts one ray from the camera through the
+// camera plane and walks the grid a cell boundary at a time (dda) until it runs into a solid cell. with avx2 eight
+// columns walk together, lanes that have hit drop out of the mask and the group finishes when the last one does.
+// column groups are spread across the job system.
+// the grid keeps a chebyshev distance field next to the cells, a ray in a cell n away from the nearest wall can cross
+// the whole open square around it in one go, so open areas cost a handful of steps however big the map is.
+
+namespace tdjx
+{
+    namespace raycast
+    {
+        const int kMaxGridSize = 4096;
+
+        // distances stop counting here, plenty to cross open ground in big strides
+        const int kMaxDistance = 255;
+
+        // cells are 0 for empty, anything else is solid and the value is left for picking the wall's look
+        struct Grid
+        {
+            std::vector<uint8> cells;
+            // 1 bit per cell row by row, set for solid cells, what the walk actually tests
+            std::vector<uint32> occupancy;
+            // chebyshev distance from each cell to the nearest solid one (0 for solid cells), outside the grid counts
+            // as open. padded past the last cell so the simd path can gather 4 bytes at any cell
+            std::vector<uint8> distance;
+            int width = 0;
+            int height = 0;
+        };
+
+        namespace grid
+        {
+            // all open, up to kMaxGridSize on a side
+            Grid create(int width, int height);
+            // one char per cell row by row, spaces are empty and anything else becomes a solid cell of that value
+            Grid create_from_string(const char* data, int width, int height);
+            // one pixel per cell, palette index 0 (or transparent) is open and anything else is a solid cell of that
+            // index. colours are looked up in the gfx palette so it has to be loaded first
+            bool try_load_from_image(const char* filename, Grid& out);
+
+            uint8 get_cell(const Grid& self, int x, int y);
+            // distance field goes stale until update_distance
+            void set_cell(Grid& self, int x, int y, uint8 value);
+            void update_distance(Grid& self);
+        }
+
+        // per column results, one entry per column
+        struct Hits
+        {
+            // distance to the wall along the view direction (not along the ray so walls don't bow), kMiss for none
+            std::vector<float32> distance;
+            // 0 when the ray crossed a vertical grid line (the wall faces x), 1 for a horizontal one
+            std::vector<uint8> side;
+            std::vector<int32> cellX;
+            std::vector<int32> cellY;
+            // 0..1 along the face of the wall that was hit
+            std::vector<float32> u;
+        };
+
+        const float32 kMiss = 1e30f;
+
+        // a single ray, direction doesn't have to be normalized, distance comes back in multiples of it
+        bool cast(const Grid& grid, float32 ox, float32 oy, float32 dx, float32 dy,
+            float32& distance, int& side, int& cellX, int& cellY, float32& u);
+
+        // count columns across the camera plane, column i goes through dir + plane * ((2 * i + 1) / count - 1).
+        // dir should be unit length for distance to be in cells
+        void cast_columns(const Grid& grid, float32 ox, float32 oy, float32 dirX, float32 dirY,
+            float32 planeX, float32 planeY, int count, Hits& out);
+    }
+}
@@ -2,6 +2,7 @@
 
 #include <GL/gl3w.h>
 #include <SDL2/SDL.h>
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
 #include <sstream>
@@ -25,6 +26,9 @@ namespace tdjx
             SDL_GLContext gl;
             int width;
             int height;
+            // part of the intensity texture the last upload covered
+            int areaWidth;
+            int areaHeight;
             uint emptyVao;
             Material material;
             SDL_Window* window;
@@ -56,11 +60,32 @@ namespace tdjx
             glUseProgram(0);
         }
 
-        void set_intensity(const uint8* data)
+        void resize_buffer(int width, int height)
         {
+            r.width = width;
+            r.height = height;
+            r.areaWidth = std::min(r.areaWidth, width);
+            r.areaHeight = std::min(r.areaHeight, height);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, get_texture(Textures::kIntensity));
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, r.width, r.height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        void set_intensity(const uint8* data, int width, int height)
+        {
+            r.areaWidth = std::min(width, r.width);
+            r.areaHeight = std::min(height, r.height);
+
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, get_texture(Textures::kIntensity));
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, r.width, r.height, GL_RED, GL_UNSIGNED_BYTE, data);
+            // rows are tightly packed and any width is allowed
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, r.areaWidth, r.areaHeight, GL_RED, GL_UNSIGNED_BYTE, data);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             glBindTexture(GL_TEXTURE_2D, 0);
         }
 
@@ -69,6 +94,8 @@ namespace tdjx
             r.window = window;
             r.width = bufferWidth;
             r.height = bufferHeight;
+            r.areaWidth = bufferWidth;
+            r.areaHeight = bufferHeight;
 
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
             SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
@@ -129,7 +156,7 @@ namespace tdjx
 
             r.material = material::create("assets/shaders/screen_quad.vert",
                 "assets/shaders/screen_quad_indexed.frag",
-                { "intensity", "palette", "mode", "scalar" });
+                { "intensity", "palette", "mode", "scalar", "area" });
 
             on_resize();
 
@@ -204,6 +231,10 @@ namespace tdjx
             glBindTexture(GL_TEXTURE_2D, get_texture(Textures::kPalette));
             glUniform1i(r.material.uniforms["palette"], 1);
 
+            glUniform2f(r.material.uniforms["area"],
+                static_cast<float32>(r.areaWidth) / r.width,
+                static_cast<float32>(r.areaHeight) / r.height);
+
             glActiveTexture(GL_TEXTURE0);
 
             glBindVertexArray(r.emptyVao);
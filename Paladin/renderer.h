@@ -39,7 +39,10 @@ namespace tdjx
 
         void set_texture_data(uint* data, int width, int height);
         void set_palette(const uint8* data, int size);
-        void set_intensity(const uint8* data);
+        // texture the screen gets uploaded to, the largest the screen will ever be
+        void resize_buffer(int width, int height);
+        // width x height is the part of the buffer in use, that part gets stretched over the window
+        void set_intensity(const uint8* data, int width, int height);
 
         void reload_shaders();
 
@@ -10,6 +10,7 @@
 
 #include "util.h"
 #include "renderer.h"
+#include "tdjx_simd.h"
 
 using namespace tdjx::math;
 
@@ -58,6 +59,8 @@ namespace tdjx
             Canvas screenCanvas;
             Canvas& activeCanvas = screenCanvas;
             Rect<int> clipArea = Rect<int>{ 0, 0, 0, 0 };
+            int minWidth = 0, minHeight = 0;
+            int maxWidth = 0, maxHeight = 0;
             Palette palette;
             ByteImage imageBank[kMaxLoadedImages];
             int nextImageId = 0;
@@ -120,6 +123,8 @@ namespace tdjx
             set_canvas();
 
             g_gfx.clipArea = { 0, 0, width - 1, height - 1 };
+            g_gfx.minWidth = g_gfx.maxWidth = width;
+            g_gfx.minHeight = g_gfx.maxHeight = height;
 
             load_palette("assets/palettes/arne32.png");
         }
@@ -164,6 +169,15 @@ namespace tdjx
             // one day
         }
 
+        const ByteImage* get_image(ImageHandle imageHandle)
+        {
+            if (imageHandle < 0 || imageHandle >= g_gfx.nextImageId)
+            {
+                return nullptr;
+            }
+            return &g_gfx.imageBank[imageHandle];
+        }
+
         void mask_color(int& color)
         {
             color = (color & g_gfx.palette.mask);
@@ -184,6 +198,17 @@ namespace tdjx
             std::copy(canvas.data.begin(), canvas.data.end(), g_gfx.screenCanvas.data.begin());
         }
 
+        void draw_columns_to_screen(const Canvas& columns)
+        {
+            if (columns.width != g_gfx.screenCanvas.height || columns.height != g_gfx.screenCanvas.width)
+            {
+                printf("Column canvas %dx%d doesn't fit the %dx%d screen.\n", columns.height, columns.width,
+                    g_gfx.screenCanvas.width, g_gfx.screenCanvas.height);
+                return;
+            }
+            canvas::transpose(columns, g_gfx.screenCanvas);
+        }
+
         void clear(int color)
         {
             mask_color(color);
@@ -521,27 +546,49 @@ namespace tdjx
 
         void blit(ImageHandle imageHandle, int x0, int y0)
         {
-            const ByteImage image = g_gfx.imageBank[imageHandle];
+            const ByteImage* image = get_image(imageHandle);
+            if (!image)
+            {
+                return;
+            }
 
-            Rect<int> r = { x0, y0, x0 + image.width - 1, y0 + image.height - 1 };
+            Rect<int> r = { x0, y0, x0 + image->width - 1, y0 + image->height - 1 };
             if (!rect::clip_rect(g_gfx.clipArea, r))
             {
                 return;
             }
 
-            for (int y = 0; y < image.height; ++y)
+            for (int y = r.y0; y <= r.y1; ++y)
             {
-                for (int x = 0; x < image.width; ++x)
+                // image row base, indexed relative to x0 so the pointer never leaves the image
+                const uint8* source = image->data.data() + (y - y0) * image->width;
+                uint8* dest = pixel_xy(0, y);
+                for (int x = r.x0; x <= r.x1; ++x)
                 {
-                    uint8 i = image.data[y * image.width + x];
-                    *pixel_xy(x + x0, y + y0) = i;
+                    uint8 color = source[x - x0];
+                    if (color != kTransparent)
+                    {
+                        dest[x] = color;
+                    }
                 }
             }
         }
 
         void flip()
         {
-            tdjx::render::set_intensity(get_pixels());
+            tdjx::render::set_intensity(get_pixels(), g_gfx.screenCanvas.width, g_gfx.screenCanvas.height);
+        }
+
+        bool try_begin_shade(Rect<int>& area, uint8*& pixels, int& stride)
+        {
+            if (!gfx_clip_rect(area))
+            {
+                return false;
+            }
+
+            pixels = g_gfx.activeCanvas.data.data();
+            stride = g_gfx.activeCanvas.width;
+            return true;
         }
 
         void* get_context()
@@ -560,11 +607,61 @@ namespace tdjx
             height = g_gfx.screenCanvas.height;
         }
 
+        int query_palette_index(uint8 r, uint8 g, uint8 b)
+        {
+            return palette::index_from_color(g_gfx.palette, r, g, b);
+        }
+
+        std::vector<uint8> create_shade_table(int levels)
+        {
+            const Palette& palette = g_gfx.palette;
+            const int kChannels = 4;
+
+            std::vector<uint8> result(levels * 256);
+            for (int level = 0; level < levels; ++level)
+            {
+                uint8* table = result.data() + level * 256;
+                int brightness = levels - level;
+                for (int i = 0; i < 256; ++i)
+                {
+                    table[i] = static_cast<uint8>(i);
+                    if (i >= palette.size)
+                    {
+                        continue;
+                    }
+
+                    const uint8* color = palette.data.data() + i * kChannels;
+                    int r = color[0] * brightness / levels;
+                    int g = color[1] * brightness / levels;
+                    int b = color[2] * brightness / levels;
+
+                    int best = -1;
+                    for (int j = 0; j < palette.size; ++j)
+                    {
+                        const uint8* other = palette.data.data() + j * kChannels;
+                        int dr = other[0] - r, dg = other[1] - g, db = other[2] - b;
+                        int distance = dr * dr + dg * dg + db * db;
+                        if (best < 0 || distance < best)
+                        {
+                            best = distance;
+                            table[i] = static_cast<uint8>(j);
+                        }
+                    }
+                }
+            }
+            return result;
+        }
+
         void query_palette_size(int& size)
         {
             size = g_gfx.palette.size;
         }
 
+        void query_palette_mask(int& mask)
+        {
+            mask = g_gfx.palette.mask;
+        }
+
         namespace palette
         {
             bool try_create_palette_from_file(const char* filename, Palette& out)
@@ -638,17 +735,26 @@ namespace tdjx
                 {
                     uint8* pixel = &data[i * bpp];
 
+                    // fully transparent pixels keep that through to blits whatever colour they are
+                    bool hasAlpha = bpp == 2 || bpp == 4;
+                    if (hasAlpha && pixel[bpp - 1] == 0)
+                    {
+                        out.data[i] = kTransparent;
+                        continue;
+                    }
+
                     uint8 v = 0;
                     switch (bpp)
                     {
                         // 1 or 2 channel images have an intensity and optional alpha so it's pretty easy to 
                     case 1:
                     case 2:
-                        v = *pixel; break;
+                        v = *pixel;
                         if (v >= palette.size)
                         {
                             return false;
                         }
+                        break;
                     case 3:
                     case 4:
                     {
@@ -666,7 +772,8 @@ namespace tdjx
                     break;
                     default: break;
                     }
-                    out.data[i] = v * palette.scalar;
+                    // palette indices like everything else drawn to a canvas
+                    out.data[i] = v;
                 }
 
                 return true;
@@ -683,6 +790,246 @@ namespace tdjx
             }
         }
 
+        void set_resolution_bounds(int minWidth, int minHeight, int maxWidth, int maxHeight)
+        {
+            g_gfx.minWidth = std::max(1, minWidth);
+            g_gfx.minHeight = std::max(1, minHeight);
+            g_gfx.maxWidth = std::max(g_gfx.minWidth, maxWidth);
+            g_gfx.maxHeight = std::max(g_gfx.minHeight, maxHeight);
+
+            tdjx::render::resize_buffer(g_gfx.maxWidth, g_gfx.maxHeight);
+            resize_screen(g_gfx.screenCanvas.width, g_gfx.screenCanvas.height);
+        }
+
+        void query_resolution_bounds(int& minWidth, int& minHeight, int& maxWidth, int& maxHeight)
+        {
+            minWidth = g_gfx.minWidth;
+            minHeight = g_gfx.minHeight;
+            maxWidth = g_gfx.maxWidth;
+            maxHeight = g_gfx.maxHeight;
+        }
+
+        void resize_screen(int width, int height)
+        {
+            width = std::clamp(width, g_gfx.minWidth, g_gfx.maxWidth);
+            height = std::clamp(height, g_gfx.minHeight, g_gfx.maxHeight);
+            if (width == g_gfx.screenCanvas.width && height == g_gfx.screenCanvas.height)
+            {
+                return;
+            }
+
+            // activeCanvas refers to the screen so it follows along
+            g_gfx.screenCanvas.data.assign(width * height, 0);
+            g_gfx.screenCanvas.width = width;
+            g_gfx.screenCanvas.height = height;
+            g_gfx.clipArea = { 0, 0, width - 1, height - 1 };
+        }
+
+        namespace dynamic_resolution
+        {
+            // frames to let the average settle after a resize before judging the new size
+            const int kSettleFrames = 15;
+            // how much of each new frame goes into the average
+            const float32 kSmoothing = 0.1f;
+            // anything within this fraction of the target is close enough to leave alone
+            const float32 kTolerance = 0.1f;
+            // widths stay multiples of this so sizes don't creep by a pixel at a time
+            const int kWidthStep = 8;
+
+            bool update(DynamicResolution& self, float32 rasterMs)
+            {
+                if (rasterMs <= 0.0f || self.targetMs <= 0.0f)
+                {
+                    return false;
+                }
+
+                self.averageMs = (self.averageMs > 0.0f) ? self.averageMs + (rasterMs - self.averageMs) * kSmoothing : rasterMs;
+                if (++self.framesSinceResize < kSettleFrames)
+                {
+                    return false;
+                }
+
+                float32 ratio = self.targetMs / self.averageMs;
+                if (ratio > 1.0f - kTolerance && ratio < 1.0f + kTolerance)
+                {
+                    return false;
+                }
+
+                // raster time goes with the pixel count so each side moves by the square root, at most doubling
+                // or halving the pixels in one go
+                int oldWidth = g_gfx.screenCanvas.width;
+                int oldHeight = g_gfx.screenCanvas.height;
+                float32 scale = std::sqrt(std::clamp(ratio, 0.5f, 2.0f));
+
+                int width = static_cast<int>(std::round(oldWidth * scale / kWidthStep)) * kWidthStep;
+                width = std::clamp(width, g_gfx.minWidth, g_gfx.maxWidth);
+                int height = static_cast<int>(std::round(static_cast<float32>(width) * g_gfx.maxHeight / g_gfx.maxWidth));
+
+                resize_screen(width, height);
+                if (g_gfx.screenCanvas.width == oldWidth && g_gfx.screenCanvas.height == oldHeight)
+                {
+                    return false;
+                }
+
+                // guess at the new cost until real frames come in
+                self.averageMs *= static_cast<float32>(g_gfx.screenCanvas.width * g_gfx.screenCanvas.height) / (oldWidth * oldHeight);
+                self.framesSinceResize = 0;
+                return true;
+            }
+        }
+
+        namespace interlace
+        {
+            // which pixel of each 2x2 block the quarter mode evaluates, diagonals first so two frames in
+            // already covers the block as evenly as the checkerboard does
+            const int kQuarterOrder[4][2] = { { 0, 0 }, { 1, 1 }, { 1, 0 }, { 0, 1 } };
+
+            const char* get_mode_name(InterlaceMode mode)
+            {
+                switch (mode)
+                {
+                case InterlaceMode::Off: return "Off";
+                case InterlaceMode::Checkerboard: return "Checkerboard";
+                case InterlaceMode::Rows: return "Rows";
+                case InterlaceMode::Quarter: return "Quarter";
+                default: return "Unknown";
+                }
+            }
+
+            void reset(Interlace& self)
+            {
+                self.valid = false;
+            }
+
+            bool begin_frame(Interlace& self)
+            {
+                int width = g_gfx.screenCanvas.width;
+                int height = g_gfx.screenCanvas.height;
+                if (self.history.data.size() != static_cast<size_t>(width * height) || self.history.width != width)
+                {
+                    self.history = canvas::create_blank_from_screen();
+                    self.valid = false;
+                }
+
+                if (self.historyMode != self.mode)
+                {
+                    self.historyMode = self.mode;
+                    self.valid = false;
+                }
+
+                return self.valid && self.mode != InterlaceMode::Off;
+            }
+
+            void end_frame(Interlace& self)
+            {
+                self.valid = true;
+                ++self.frame;
+            }
+
+            bool is_fresh(const Interlace& self, int x, int y)
+            {
+                uint32 frame = self.frame;
+                switch (self.mode)
+                {
+                case InterlaceMode::Checkerboard: return ((x + y + frame) & 1) == 0;
+                case InterlaceMode::Rows: return ((y + frame) & 1) == 0;
+                case InterlaceMode::Quarter:
+                {
+                    const int* offset = kQuarterOrder[frame & 3];
+                    return (x & 1) == offset[0] && (y & 1) == offset[1];
+                }
+                default: return true;
+                }
+            }
+
+            int get_row_span(const Interlace& self, bool full, int y, int x0, int x1, int& first, int& xStep)
+            {
+                first = x0;
+                xStep = 1;
+                if (!full)
+                {
+                    uint32 frame = self.frame;
+                    switch (self.mode)
+                    {
+                    case InterlaceMode::Checkerboard:
+                        first = x0 + ((x0 + y + frame) & 1);
+                        xStep = 2;
+                        break;
+
+                    case InterlaceMode::Rows:
+                        if (((y + frame) & 1) != 0)
+                        {
+                            return 0;
+                        }
+                        break;
+
+                    case InterlaceMode::Quarter:
+                    {
+                        const int* offset = kQuarterOrder[frame & 3];
+                        if ((y & 1) != offset[1])
+                        {
+                            return 0;
+                        }
+                        first = x0 + ((x0 & 1) != offset[0] ? 1 : 0);
+                        xStep = 2;
+                        break;
+                    }
+
+                    default:
+                        break;
+                    }
+                }
+
+                if (first > x1)
+                {
+                    return 0;
+                }
+                return (x1 - first) / xStep + 1;
+            }
+
+            void resolve_row(Interlace& self, bool full, const Rect<int>& area, int y, uint8* row)
+            {
+                uint8* history = self.history.data.data();
+                int stride = self.history.width;
+                uint8* source = history + y * stride;
+
+                if (full || !self.rejectMotion)
+                {
+                    std::copy(source + area.x0, source + area.x1 + 1, row + area.x0);
+                    return;
+                }
+
+                int ny0 = std::max(area.y0, y - 1), ny1 = std::min(area.y1, y + 1);
+                for (int x = area.x0; x <= area.x1; ++x)
+                {
+                    if (!is_fresh(self, x, y))
+                    {
+                        // every pattern leaves at least one fresh pixel in the 3x3 around a stale one
+                        int lo = 255, hi = 0;
+                        int nx0 = std::max(area.x0, x - 1), nx1 = std::min(area.x1, x + 1);
+                        for (int ny = ny0; ny <= ny1; ++ny)
+                        {
+                            for (int nx = nx0; nx <= nx1; ++nx)
+                            {
+                                if (is_fresh(self, nx, ny))
+                                {
+                                    int value = history[ny * stride + nx];
+                                    lo = std::min(lo, value);
+                                    hi = std::max(hi, value);
+                                }
+                            }
+                        }
+
+                        if (lo <= hi)
+                        {
+                            source[x] = static_cast<uint8>(std::clamp(static_cast<int>(source[x]), lo, hi));
+                        }
+                    }
+                    row[x] = source[x];
+                }
+            }
+        }
+
         namespace canvas
         {
             uint8* pixel_xy(Canvas& canvas, int x, int y)
@@ -709,6 +1056,83 @@ namespace tdjx
                 std::copy(g_gfx.screenCanvas.data.begin(), g_gfx.screenCanvas.data.end(), result.data.begin());
                 return result;
             }
+
+            Canvas create_columns_from_screen()
+            {
+                Canvas result;
+                result.width = g_gfx.screenCanvas.height;
+                result.height = g_gfx.screenCanvas.width;
+                result.data.assign(result.width * result.height, 0);
+                return result;
+            }
+
+            const int kTransposeBlock = 16;
+
+            // sse2 is always there on x64. every round interleaves row k with row k + 8, four of them move every byte
+            // across to its transposed spot
+            void transpose_block(const uint8* source, int sourceStride, uint8* dest, int destStride)
+            {
+                __m128i rows[kTransposeBlock], mixed[kTransposeBlock];
+                for (int k = 0; k < kTransposeBlock; ++k)
+                {
+                    rows[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + k * sourceStride));
+                }
+
+                for (int round = 0; round < 4; ++round)
+                {
+                    for (int k = 0; k < kTransposeBlock / 2; ++k)
+                    {
+                        mixed[2 * k] = _mm_unpacklo_epi8(rows[k], rows[k + kTransposeBlock / 2]);
+                        mixed[2 * k + 1] = _mm_unpackhi_epi8(rows[k], rows[k + kTransposeBlock / 2]);
+                    }
+                    std::copy(mixed, mixed + kTransposeBlock, rows);
+                }
+
+                for (int k = 0; k < kTransposeBlock; ++k)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + k * destStride), rows[k]);
+                }
+            }
+
+            void transpose(const Canvas& source, Canvas& dest)
+            {
+                int width = source.width, height = source.height;
+                dest.width = height;
+                dest.height = width;
+                dest.data.resize(width * height);
+
+                const uint8* from = source.data.data();
+                uint8* to = dest.data.data();
+
+                // a strip of source rows per job, each one writes its own strip of dest columns
+                int strips = (height + kTransposeBlock - 1) / kTransposeBlock;
+                jobs::parallel_for(0, strips, 1, [&](int begin, int end)
+                {
+                    for (int strip = begin; strip < end; ++strip)
+                    {
+                        int y0 = strip * kTransposeBlock;
+                        int y1 = std::min(y0 + kTransposeBlock, height);
+
+                        int x = 0;
+                        if (y1 - y0 == kTransposeBlock)
+                        {
+                            for (; x + kTransposeBlock <= width; x += kTransposeBlock)
+                            {
+                                transpose_block(from + y0 * width + x, width, to + x * height + y0, height);
+                            }
+                        }
+
+                        // whatever doesn't fill a block
+                        for (int y = y0; y < y1; ++y)
+                        {
+                            for (int tx = x; tx < width; ++tx)
+                            {
+                                to[tx * height + y] = from[y * width + tx];
+                            }
+                        }
+                    }
+                });
+            }
         }
     }
 }
\ No newline at end of file
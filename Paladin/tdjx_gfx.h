@@ -2,6 +2,7 @@
 
 #include "types.h"
 #include "tdjx_math.h"
+#include "tdjx_jobs.h"
 
 #include <vector>
 #include <unordered_map>
@@ -36,16 +37,24 @@ namespace tdjx
         typedef int ImageHandle;
         const int kInvalidHandle = -1;
 
+        // images store this where they're fully transparent and blits skip it, so palettes top out at 255 colours
+        const uint8 kTransparent = 0xff;
+
         void init_with_window(int width, int height, SDL_Window* window);
         void load_palette(const char* filename);
         void shutdown();
 
         ImageHandle load_image(const char* filename);
         void free_image(ImageHandle imageHandle);
+        // nullptr for handles that haven't been loaded
+        const ByteImage* get_image(ImageHandle imageHandle);
 
         void set_canvas(Canvas& canvas);
         void set_canvas();
         void draw_canvas_to_screen(Canvas& canvas);
+        // columns is column-major (one row per screen column, see canvas::create_columns_from_screen) and gets
+        // transposed onto the screen
+        void draw_columns_to_screen(const Canvas& columns);
 
         void clear(int color);
         void point(int x, int y, int color);
@@ -66,6 +75,186 @@ namespace tdjx
         uint8* get_pixels();
         void query_screen_dimensions(int& width, int& height);
         void query_palette_size(int& size);
+        // what draw calls mask colours with before writing them
+        void query_palette_mask(int& mask);
+        // -1 if the colour isn't in the palette
+        int query_palette_index(uint8 r, uint8 g, uint8 b);
+        // levels tables of 256 entries back to back, table i maps each colour to the nearest one in the palette at
+        // (levels - i) / levels of its brightness. anything past the palette (kTransparent) maps to itself
+        std::vector<uint8> create_shade_table(int levels);
+
+        // dynamic resolution. the screen can change size between frames anywhere within the bounds (just the size it
+        // was created at until they're set), the renderer keeps a texture big enough for the largest and stretches
+        // whatever part is in use over the window
+        void set_resolution_bounds(int minWidth, int minHeight, int maxWidth, int maxHeight);
+        void query_resolution_bounds(int& minWidth, int& minHeight, int& maxWidth, int& maxHeight);
+        // clamped to the bounds, anything on the screen is lost
+        void resize_screen(int width, int height);
+
+        // picks the screen size from how long frames take to draw, aiming to hold targetMs. sizes keep the aspect of
+        // the largest bound
+        struct DynamicResolution
+        {
+            float32 targetMs = 8.0f;
+            // raster time smoothed over the last few frames
+            float32 averageMs = 0.0f;
+            int framesSinceResize = 0;
+        };
+
+        namespace dynamic_resolution
+        {
+            // feed it the time the last frame took to draw before drawing the next, true if the screen changed size
+            bool update(DynamicResolution& self, float32 rasterMs);
+        }
+
+        // rows handed to each job, small enough to balance uneven rows, big enough to keep scheduling cheap
+        const int kRowBandSize = 4;
+
+        // splits rows y0..y1 into bands and runs fn(bandY0, bandY1) for each across the job system,
+        // returning once every band is done
+        template <typename t_fn>
+        void parallel_rows(int y0, int y1, t_fn&& fn)
+        {
+            jobs::parallel_for(y0, y1 + 1, kRowBandSize, [&fn](int begin, int end)
+            {
+                fn(begin, end - 1);
+            });
+        }
+
+        // clips area against the clip rect and returns the active canvas' pixels and row stride
+        bool try_begin_shade(Rect<int>& area, uint8*& pixels, int& stride);
+
+        // cpu pixel shader. area is clipped once up front then fn(row, x0, x1, y) is called for every row with
+        // row pointing at column 0 of that row, so it writes row[x0..x1] however it likes (including simd)
+        template <typename t_fn>
+        void shade(Rect<int> area, t_fn&& fn)
+        {
+            uint8* pixels;
+            int stride;
+            if (!try_begin_shade(area, pixels, stride))
+            {
+                return;
+            }
+
+            parallel_rows(area.y0, area.y1, [&](int y0, int y1)
+            {
+                for (int y = y0; y <= y1; ++y)
+                {
+                    fn(pixels + y * stride, area.x0, area.x1, y);
+                }
+            });
+        }
+
+        // per pixel form of shade, fn(x, y) returns the palette index for that pixel
+        template <typename t_fn>
+        void shade_pixels(Rect<int> area, t_fn&& fn)
+        {
+            int mask;
+            query_palette_mask(mask);
+
+            shade(area, [&](uint8* row, int x0, int x1, int y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    row[x] = static_cast<uint8>(fn(x, y) & mask);
+                }
+            });
+        }
+
+        // partial shading for per pixel effects that barely change between frames. each frame evaluates a rotating
+        // subset of the pixels and carries the rest over from the frame before, kept in history
+        enum class InterlaceMode
+        {
+            Off,
+            // half the pixels, alternating like a checkerboard
+            Checkerboard,
+            // every other row
+            Rows,
+            // one pixel out of each 2x2 block
+            Quarter,
+            Count,
+        };
+
+        struct Interlace
+        {
+            InterlaceMode mode = InterlaceMode::Checkerboard;
+            // carried over pixels get clamped to the range of the fresh pixels around them, stops anything that
+            // moves from smearing at the cost of a little detail
+            bool rejectMotion = true;
+
+            uint32 frame = 0;
+            Canvas history;
+            // history holds a whole frame of the current mode, everything gets evaluated until it does
+            bool valid = false;
+            InterlaceMode historyMode = InterlaceMode::Off;
+        };
+
+        namespace interlace
+        {
+            const char* get_mode_name(InterlaceMode mode);
+
+            // next frame evaluates every pixel, for when the effect changes too much to carry anything over
+            void reset(Interlace& self);
+
+            // sizes history to the screen, false if the whole area has to be evaluated this frame
+            bool begin_frame(Interlace& self);
+            void end_frame(Interlace& self);
+
+            // pixels on row y evaluated this frame, as count pixels at (first + i * xStep) inside x0..x1
+            int get_row_span(const Interlace& self, bool full, int y, int x0, int x1, int& first, int& xStep);
+
+            // copies history row y onto row, filling in carried over pixels once every fresh one in area is done
+            void resolve_row(Interlace& self, bool full, const Rect<int>& area, int y, uint8* row);
+        }
+
+        // shade that only evaluates this frame's share of the pixels. fn(y, x0, xStep, count, out) writes count palette
+        // indices for the pixels at (x0 + i * xStep, y), the rest of area is reconstructed from the previous frame
+        template <typename t_fn>
+        void shade_interlaced(Interlace& self, Rect<int> area, t_fn&& fn)
+        {
+            uint8* pixels;
+            int stride;
+            if (!try_begin_shade(area, pixels, stride))
+            {
+                return;
+            }
+
+            bool full = !interlace::begin_frame(self);
+
+            parallel_rows(area.y0, area.y1, [&](int y0, int y1)
+            {
+                static thread_local std::vector<uint8> t_values;
+                for (int y = y0; y <= y1; ++y)
+                {
+                    int x0, xStep;
+                    int count = interlace::get_row_span(self, full, y, area.x0, area.x1, x0, xStep);
+                    if (count <= 0)
+                    {
+                        continue;
+                    }
+
+                    t_values.resize(count);
+                    fn(y, x0, xStep, count, t_values.data());
+
+                    uint8* dest = self.history.data.data() + y * self.history.width + x0;
+                    for (int i = 0; i < count; ++i)
+                    {
+                        dest[i * xStep] = t_values[i];
+                    }
+                }
+            });
+
+            // second pass so every fresh neighbour is in place before anything gets clamped against it
+            parallel_rows(area.y0, area.y1, [&](int y0, int y1)
+            {
+                for (int y = y0; y <= y1; ++y)
+                {
+                    interlace::resolve_row(self, full, area, y, pixels + y * stride);
+                }
+            });
+
+            interlace::end_frame(self);
+        }
 
         namespace palette
         {
@@ -85,6 +274,11 @@ namespace tdjx
             uint8* pixel_xy(Canvas& canvas, int x, int y);
             Canvas create_blank_from_screen();
             Canvas create_copy_from_screen();
+            // the screen on its side, width is the screen's height and row x holds screen column x top to bottom, so
+            // vertical spans are contiguous
+            Canvas create_columns_from_screen();
+            // dest(x, y) = source(y, x), dest is resized to fit. 16x16 blocks at a time spread across the job system
+            void transpose(const Canvas& source, Canvas& dest);
         }
     }
 }
@@ -0,0 +1,493 @@
+#include "tdjx_jobs.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+#include "imgui.h"
+
+namespace tdjx
+{
+    namespace jobs
+    {
+        // jobs that don't fit in a full deque just run on the spot
+        const uint32 kDequeCapacity = 4096;
+        const uint32 kDequeMask = kDequeCapacity - 1;
+
+        // failed searches before a worker goes to sleep
+        const int kIdleSpins = 64;
+
+        // owner works the tail, thieves take from the head. the lock is only ever held for a couple of loads
+        // and stores so a spin lock beats anything smarter at these sizes
+        struct alignas(64) WorkDeque
+        {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            uint32 head = 0;
+            uint32 tail = 0;
+            Job jobs[kDequeCapacity];
+        };
+
+        struct
+        {
+            std::unique_ptr<WorkDeque[]> deques;
+            std::vector<std::thread> workers;
+            int threadCount = 1;
+            bool running = false;
+
+            // jobs sitting in any deque, lets sleeping workers know when to wake
+            std::atomic<int> queued{ 0 };
+            std::atomic<int> sleeping{ 0 };
+            std::atomic<bool> quit{ false };
+            std::mutex sleepMutex;
+            std::condition_variable sleepCondition;
+
+            std::mutex mainMutex;
+            std::vector<Job> mainJobs;
+        } g_jobs;
+
+        thread_local int t_threadIndex = 0;
+        thread_local uint32 t_stealSeed = 0x9e3779b9u;
+
+        struct spin_guard
+        {
+            std::atomic_flag& flag;
+
+            spin_guard(std::atomic_flag& flag) : flag(flag)
+            {
+                while (flag.test_and_set(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            ~spin_guard()
+            {
+                flag.clear(std::memory_order_release);
+            }
+        };
+
+        bool try_push(WorkDeque& self, const Job& job)
+        {
+            spin_guard guard(self.lock);
+            if (self.tail - self.head == kDequeCapacity)
+            {
+                return false;
+            }
+            self.jobs[self.tail & kDequeMask] = job;
+            ++self.tail;
+            return true;
+        }
+
+        bool try_pop(WorkDeque& self, Job& out)
+        {
+            spin_guard guard(self.lock);
+            if (self.tail == self.head)
+            {
+                return false;
+            }
+            --self.tail;
+            out = self.jobs[self.tail & kDequeMask];
+            return true;
+        }
+
+        bool try_steal(WorkDeque& self, Job& out)
+        {
+            spin_guard guard(self.lock);
+            if (self.tail == self.head)
+            {
+                return false;
+            }
+            out = self.jobs[self.head & kDequeMask];
+            ++self.head;
+            return true;
+        }
+
+        bool try_find_job(Job& out)
+        {
+            int self = t_threadIndex;
+            if (try_pop(g_jobs.deques[self], out))
+            {
+                g_jobs.queued.fetch_sub(1);
+                return true;
+            }
+
+            // start each search somewhere different so thieves don't all pile onto the same victim
+            t_stealSeed ^= t_stealSeed << 13;
+            t_stealSeed ^= t_stealSeed >> 17;
+            t_stealSeed ^= t_stealSeed << 5;
+
+            int count = g_jobs.threadCount;
+            int start = static_cast<int>(t_stealSeed % count);
+            for (int i = 0; i < count; ++i)
+            {
+                int victim = (start + i) % count;
+                if (victim != self && try_steal(g_jobs.deques[victim], out))
+                {
+                    g_jobs.queued.fetch_sub(1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void submit(const Job& job);
+
+        void finish(Counter& counter)
+        {
+            // the decrement happens under the lock so a waiter can't see zero and throw the counter away while
+            // we're still reading its continuations, see wait
+            std::vector<Job> ready;
+            {
+                std::lock_guard<std::mutex> lock(counter.mutex);
+                if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1 || counter.continuations.empty())
+                {
+                    return;
+                }
+                ready.swap(counter.continuations);
+            }
+
+            for (const Job& job : ready)
+            {
+                submit(job);
+            }
+        }
+
+        void execute(const Job& job)
+        {
+            job.fn(job.data);
+            if (job.counter)
+            {
+                finish(*job.counter);
+            }
+        }
+
+        // job's counter has already been bumped by the time it gets here
+        void submit(const Job& job)
+        {
+            if (!g_jobs.running || !try_push(g_jobs.deques[t_threadIndex], job))
+            {
+                execute(job);
+                return;
+            }
+
+            g_jobs.queued.fetch_add(1);
+            if (g_jobs.sleeping.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(g_jobs.sleepMutex);
+                g_jobs.sleepCondition.notify_one();
+            }
+        }
+
+        void worker_main(int index)
+        {
+            t_threadIndex = index;
+            t_stealSeed += static_cast<uint32>(index) * 0x85ebca6bu;
+
+            int idle = 0;
+            while (!g_jobs.quit.load(std::memory_order_relaxed))
+            {
+                Job job;
+                if (try_find_job(job))
+                {
+                    execute(job);
+                    idle = 0;
+                    continue;
+                }
+
+                if (++idle < kIdleSpins)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                g_jobs.sleeping.fetch_add(1);
+                {
+                    std::unique_lock<std::mutex> lock(g_jobs.sleepMutex);
+                    g_jobs.sleepCondition.wait(lock, []() { return g_jobs.queued.load() > 0 || g_jobs.quit.load(); });
+                }
+                g_jobs.sleeping.fetch_sub(1);
+                idle = 0;
+            }
+        }
+
+        void init(int workerCount)
+        {
+            if (g_jobs.running)
+            {
+                return;
+            }
+
+            if (workerCount < 0)
+            {
+                unsigned int cores = std::thread::hardware_concurrency();
+                workerCount = (cores > 1) ? static_cast<int>(cores) - 1 : 0;
+            }
+
+            g_jobs.threadCount = workerCount + 1;
+            g_jobs.deques.reset(new WorkDeque[g_jobs.threadCount]);
+            g_jobs.queued = 0;
+            g_jobs.quit = false;
+            g_jobs.running = true;
+
+            t_threadIndex = 0;
+            for (int i = 1; i <= workerCount; ++i)
+            {
+                g_jobs.workers.emplace_back(worker_main, i);
+            }
+        }
+
+        void shutdown()
+        {
+            if (!g_jobs.running)
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(g_jobs.sleepMutex);
+                g_jobs.quit = true;
+            }
+            g_jobs.sleepCondition.notify_all();
+
+            for (std::thread& worker : g_jobs.workers)
+            {
+                worker.join();
+            }
+            g_jobs.workers.clear();
+
+            g_jobs.running = false;
+            g_jobs.deques.reset();
+            g_jobs.threadCount = 1;
+
+            pump_main();
+        }
+
+        int thread_count()
+        {
+            return g_jobs.running ? g_jobs.threadCount : 1;
+        }
+
+        int thread_index()
+        {
+            return t_threadIndex;
+        }
+
+        void run(const Job& job)
+        {
+            if (job.counter)
+            {
+                job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+            }
+            submit(job);
+        }
+
+        void run(const Job* jobs, int count)
+        {
+            // count everything first so the counter can't touch zero while the batch is still going out
+            for (int i = 0; i < count; ++i)
+            {
+                if (jobs[i].counter)
+                {
+                    jobs[i].counter->pending.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                submit(jobs[i]);
+            }
+        }
+
+        void run_after(Counter& dependency, const Job& job)
+        {
+            if (job.counter)
+            {
+                job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(dependency.mutex);
+                if (dependency.pending.load(std::memory_order_acquire) > 0)
+                {
+                    dependency.continuations.push_back(job);
+                    return;
+                }
+            }
+
+            submit(job);
+        }
+
+        void run_on_main(const Job& job)
+        {
+            if (job.counter)
+            {
+                job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            std::lock_guard<std::mutex> lock(g_jobs.mainMutex);
+            g_jobs.mainJobs.push_back(job);
+        }
+
+        void pump_main()
+        {
+            if (t_threadIndex != 0)
+            {
+                return;
+            }
+
+            std::vector<Job> ready;
+            {
+                std::lock_guard<std::mutex> lock(g_jobs.mainMutex);
+                ready.swap(g_jobs.mainJobs);
+            }
+
+            for (const Job& job : ready)
+            {
+                execute(job);
+            }
+        }
+
+        void wait(Counter& counter)
+        {
+            while (counter.pending.load(std::memory_order_acquire) > 0)
+            {
+                pump_main();
+
+                Job job;
+                if (g_jobs.running && try_find_job(job))
+                {
+                    execute(job);
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            // whoever took it to zero may still be inside finish
+            std::lock_guard<std::mutex> lock(counter.mutex);
+        }
+
+        // benchmark
+
+        void run_benchmark(std::vector<BenchmarkResult>& out)
+        {
+            using clock = std::chrono::steady_clock;
+            auto ns_since = [](clock::time_point start)
+            {
+                return std::chrono::duration<float64, std::nano>(clock::now() - start).count();
+            };
+
+            out.clear();
+
+            // empty jobs, pure scheduling cost
+            {
+                const int kBatch = 256;
+                const int kBatches = 256;
+
+                std::atomic<int> ran{ 0 };
+                auto empty = [&ran]() { ran.fetch_add(1, std::memory_order_relaxed); };
+
+                Counter counter;
+                Job batch[kBatch];
+                for (Job& job : batch)
+                {
+                    job = make_job(empty, &counter);
+                }
+
+                clock::time_point start = clock::now();
+                for (int i = 0; i < kBatches; ++i)
+                {
+                    run(batch, kBatch);
+                    wait(counter);
+                }
+                out.push_back({ "empty job, batches of 256", ns_since(start) / (kBatch * kBatches) });
+
+                start = clock::now();
+                for (int i = 0; i < kBatch * kBatches / 16; ++i)
+                {
+                    run(batch[0]);
+                    wait(counter);
+                }
+                out.push_back({ "empty job, run then wait", ns_since(start) / (kBatch * kBatches / 16) });
+            }
+
+            // a full fan out and join with nothing to do
+            {
+                const int kCalls = 4096;
+                int width = thread_count() * 4;
+
+                clock::time_point start = clock::now();
+                for (int i = 0; i < kCalls; ++i)
+                {
+                    parallel_for(0, width, 1, [](int, int) {});
+                }
+                out.push_back({ "parallel_for fan out + join", ns_since(start) / kCalls });
+            }
+
+            // something to actually do, per element
+            {
+                const int kCount = 1 << 22;
+                std::vector<float32> values(kCount);
+                for (int i = 0; i < kCount; ++i)
+                {
+                    values[i] = static_cast<float32>(i & 1023) * 0.25f;
+                }
+
+                auto work = [&values](int begin, int end)
+                {
+                    for (int i = begin; i < end; ++i)
+                    {
+                        float32 v = values[i];
+                        values[i] = v * v * 0.5f + v * 0.25f + 1.0f;
+                    }
+                };
+
+                clock::time_point start = clock::now();
+                work(0, kCount);
+                float64 serial = ns_since(start);
+                out.push_back({ "4M element loop, serial", serial / kCount });
+
+                start = clock::now();
+                parallel_for(0, kCount, 1 << 14, work);
+                out.push_back({ "4M element loop, parallel_for", ns_since(start) / kCount });
+            }
+
+            // what you'd pay spinning up a thread per task instead
+            {
+                const int kThreads = 64;
+
+                clock::time_point start = clock::now();
+                for (int i = 0; i < kThreads; ++i)
+                {
+                    std::thread thread([]() {});
+                    thread.join();
+                }
+                out.push_back({ "std::thread create + join", ns_since(start) / kThreads });
+            }
+        }
+
+        void draw_benchmark_ui()
+        {
+            static std::vector<BenchmarkResult> s_results;
+
+            if (!ImGui::CollapsingHeader("Job Benchmark"))
+            {
+                return;
+            }
+
+            if (ImGui::Button("Run##jobs"))
+            {
+                run_benchmark(s_results);
+            }
+
+            ImGui::SameLine();
+            ImGui::Text("%d threads", thread_count());
+
+            for (const BenchmarkResult& result : s_results)
+            {
+                ImGui::Text("%-30s %10.2f ns", result.name, result.nsPerItem);
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// work stealing job system. every thread (main included) owns a deque of jobs, it pushes and pops its own from the
+// back and steals from the front of the others when it runs dry. waiting on a counter runs jobs instead of blocking
+// so jobs can spawn and wait on more jobs. main thread jobs are kept in their own queue and only run on the main
+// thread, for anything that has to touch the gl context.
+
+namespace tdjx
+{
+    namespace jobs
+    {
+        typedef void (*JobFn)(void* data);
+
+        struct Counter;
+
+        struct Job
+        {
+            JobFn fn = nullptr;
+            void* data = nullptr;
+            Counter* counter = nullptr;
+        };
+
+        // number of jobs still to finish, plus the jobs to kick off once it hits zero
+        struct Counter
+        {
+            std::atomic<int> pending{ 0 };
+            std::mutex mutex;
+            std::vector<Job> continuations;
+        };
+
+        // workerCount < 0 means one worker per core beyond the main thread
+        void init(int workerCount = -1);
+        void shutdown();
+
+        // threads running jobs including the main thread, 1 when the job system isn't running
+        int thread_count();
+        // 0 on the main thread (and any thread outside the job system), 1..n on the workers
+        int thread_index();
+
+        void run(const Job& job);
+        void run(const Job* jobs, int count);
+
+        // job runs once dependency reaches zero, straight away if it already has
+        void run_after(Counter& dependency, const Job& job);
+
+        // queued until the next pump_main or wait on the main thread
+        void run_on_main(const Job& job);
+        void pump_main();
+
+        // runs other jobs until counter reaches zero
+        void wait(Counter& counter);
+
+        template <typename t_fn>
+        Job make_job(t_fn& fn, Counter* counter = nullptr)
+        {
+            Job job;
+            job.fn = [](void* data) { (*static_cast<t_fn*>(data))(); };
+            job.data = &fn;
+            job.counter = counter;
+            return job;
+        }
+
+        // splits [begin, end) into ranges of at most grain and calls fn(rangeBegin, rangeEnd) for each across all
+        // threads, returning once they're all done. grain <= 0 picks one that gives each thread a few ranges
+        template <typename t_fn>
+        void parallel_for(int begin, int end, int grain, t_fn&& fn)
+        {
+            if (begin >= end)
+            {
+                return;
+            }
+
+            int count = end - begin;
+            if (grain <= 0)
+            {
+                grain = std::max(1, count / (thread_count() * 4));
+            }
+
+            if (count <= grain || thread_count() == 1)
+            {
+                fn(begin, end);
+                return;
+            }
+
+            struct Range
+            {
+                std::remove_reference_t<t_fn>* fn;
+                int begin, end;
+            };
+
+            const int kMaxRanges = 256;
+            int rangeCount = (count + grain - 1) / grain;
+            if (rangeCount > kMaxRanges)
+            {
+                grain = (count + kMaxRanges - 1) / kMaxRanges;
+                rangeCount = (count + grain - 1) / grain;
+            }
+
+            Counter counter;
+            Range ranges[kMaxRanges];
+            Job rangeJobs[kMaxRanges];
+            for (int i = 0; i < rangeCount; ++i)
+            {
+                int rangeBegin = begin + i * grain;
+                ranges[i] = { &fn, rangeBegin, std::min(rangeBegin + grain, end) };
+                rangeJobs[i].fn = [](void* data)
+                {
+                    Range& range = *static_cast<Range*>(data);
+                    (*range.fn)(range.begin, range.end);
+                };
+                rangeJobs[i].data = &ranges[i];
+                rangeJobs[i].counter = &counter;
+            }
+
+            run(rangeJobs, rangeCount);
+            wait(counter);
+        }
+
+        struct BenchmarkResult
+        {
+            const char* name;
+            float64 nsPerItem;
+        };
+
+        // scheduling overhead for empty jobs and parallel_for against a serial loop and raw threads
+        void run_benchmark(std::vector<BenchmarkResult>& out);
+
+        // run button and results, drawn into whatever imgui window is current
+        void draw_benchmark_ui();
+    }
+}
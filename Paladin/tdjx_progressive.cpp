@@ -0,0 +1,94 @@
+#include "tdjx_progressive.h"
+
+#include "tdjx_gfx.h"
+
+#include <cstring>
+
+namespace tdjx
+{
+    namespace progressive
+    {
+        void restart(Image& self, int width, int height)
+        {
+            self.width = width;
+            self.height = height;
+            self.pixels.assign(width * height, 0);
+            self.blockSize = kCoarsestBlock;
+            self.nextRow = 0;
+        }
+
+        bool is_finished(const Image& self)
+        {
+            return self.blockSize == 0;
+        }
+
+        float32 get_progress(const Image& self)
+        {
+            if (self.blockSize == 0)
+            {
+                return 1.0f;
+            }
+
+            // every pass counted the same, near enough since each one samples about as many pixels as all the ones
+            // before it put together
+            int passCount = 0, pass = 0;
+            for (int blockSize = kCoarsestBlock; blockSize > 0; blockSize /= 2, ++passCount)
+            {
+                if (blockSize > self.blockSize)
+                {
+                    ++pass;
+                }
+            }
+
+            int rowCount = (self.height + self.blockSize - 1) / self.blockSize;
+            return (pass + static_cast<float32>(self.nextRow) / rowCount) / passCount;
+        }
+
+        void present(const Image& self)
+        {
+            if (self.pixels.empty())
+            {
+                return;
+            }
+
+            gfx::shade(math::Rect<int>{ 0, 0, self.width - 1, self.height - 1 }, [&](uint8* row, int x0, int x1, int y)
+            {
+                std::memcpy(row + x0, self.pixels.data() + y * self.width + x0, x1 - x0 + 1);
+            });
+        }
+
+        int get_row_samples(const Image& self, int blockSize, int row, int& x0, int& xStep, int& y)
+        {
+            y = row * blockSize;
+            x0 = 0;
+            xStep = blockSize;
+
+            // on rows the previous pass already sampled every other block is done
+            if (blockSize < kCoarsestBlock && y % (blockSize * 2) == 0)
+            {
+                x0 = blockSize;
+                xStep = blockSize * 2;
+            }
+
+            if (x0 >= self.width)
+            {
+                return 0;
+            }
+            return (self.width - x0 + xStep - 1) / xStep;
+        }
+
+        void fill_row_blocks(Image& self, int blockSize, int x0, int xStep, int y, int count, const uint8* samples)
+        {
+            int y1 = std::min(y + blockSize, self.height);
+            for (int by = y; by < y1; ++by)
+            {
+                uint8* row = self.pixels.data() + by * self.width;
+                for (int i = 0; i < count; ++i)
+                {
+                    int x = x0 + i * xStep;
+                    std::memset(row + x, samples[i], std::min(blockSize, self.width - x));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "types.h"
+#include "tdjx_jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// progressive refinement for images that take longer than a frame to compute. the first pass samples one pixel per
+// 8x8 block and fills the block with it, each following pass halves the block size and only samples the pixels the
+// passes before it haven't, down to 1x1. refine works through as much as fits in a time budget and picks up where it
+// left off next frame, so the screen always has the best image so far and a change of parameters (restart) shows up
+// as a coarse image on the very next frame instead of waiting on the full one.
+
+namespace tdjx
+{
+    namespace progressive
+    {
+        const int kCoarsestBlock = 8;
+
+        struct Image
+        {
+            // palette indices, width * height
+            std::vector<uint8> pixels;
+            int width = 0;
+            int height = 0;
+
+            // block size of the pass in progress and the next row of blocks in it, block size 0 once finished
+            int blockSize = 0;
+            int nextRow = 0;
+
+            // measured cost of a sample, sizes the batches handed to the job system
+            float64 nsPerSample = 0;
+        };
+
+        // throws away anything in progress and starts over at the coarsest pass
+        void restart(Image& self, int width, int height);
+
+        bool is_finished(const Image& self);
+
+        // 0..1 across all passes
+        float32 get_progress(const Image& self);
+
+        // copies the image onto the active canvas
+        void present(const Image& self);
+
+        // pixels sampled by block row `row` of the pass with blockSize, as count pixels at (x0 + i * xStep, y)
+        int get_row_samples(const Image& self, int blockSize, int row, int& x0, int& xStep, int& y);
+
+        // every sample in a pass block gets spread over the rest of its block
+        void fill_row_blocks(Image& self, int blockSize, int x0, int xStep, int y, int count, const uint8* samples);
+
+        // works through passes until budgetMs is used up or the image is finished, always at least one batch so the
+        // image keeps moving however small the budget. sample(y, x0, xStep, count, out) writes count palette indices
+        // for the pixels at (x0 + i * xStep, y) and gets called from any thread
+        template <typename t_sample>
+        void refine(Image& self, float64 budgetMs, t_sample&& sample)
+        {
+            using clock = std::chrono::steady_clock;
+            clock::time_point start = clock::now();
+            float64 budgetNs = budgetMs * 1e6;
+
+            while (self.blockSize > 0)
+            {
+                float64 usedNs = std::chrono::duration<float64, std::nano>(clock::now() - start).count();
+
+                int blockSize = self.blockSize;
+                int rowCount = (self.height + blockSize - 1) / blockSize;
+                int samplesPerRow = (self.width + blockSize - 1) / blockSize;
+
+                // aim each batch at half of what's left so the last one doesn't run far past the budget
+                int batch = jobs::thread_count();
+                if (self.nsPerSample > 0)
+                {
+                    float64 rowNs = self.nsPerSample * samplesPerRow / jobs::thread_count();
+                    batch = std::max(1, static_cast<int>(std::max(budgetNs - usedNs, 0.0) * 0.5 / rowNs));
+                }
+                batch = std::min(batch, rowCount - self.nextRow);
+
+                std::atomic<int> sampled{ 0 };
+                clock::time_point batchStart = clock::now();
+                jobs::parallel_for(self.nextRow, self.nextRow + batch, 1, [&](int begin, int end)
+                {
+                    static thread_local std::vector<uint8> t_samples;
+                    for (int row = begin; row < end; ++row)
+                    {
+                        int x0, xStep, y;
+                        int count = get_row_samples(self, blockSize, row, x0, xStep, y);
+                        if (count <= 0)
+                        {
+                            continue;
+                        }
+
+                        t_samples.resize(count);
+                        sample(y, x0, xStep, count, t_samples.data());
+                        fill_row_blocks(self, blockSize, x0, xStep, y, count, t_samples.data());
+                        sampled.fetch_add(count, std::memory_order_relaxed);
+                    }
+                });
+
+                if (sampled > 0)
+                {
+                    float64 batchNs = std::chrono::duration<float64, std::nano>(clock::now() - batchStart).count();
+                    self.nsPerSample = batchNs * jobs::thread_count() / sampled;
+                }
+
+                self.nextRow += batch;
+                if (self.nextRow >= rowCount)
+                {
+                    self.blockSize /= 2;
+                    self.nextRow = 0;
+                }
+
+                if (std::chrono::duration<float64, std::nano>(clock::now() - start).count() >= budgetNs)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <immintrin.h>
+
+#include "util.h"
+
+// avx2 kernels live next to their sse2 fallbacks and get picked at runtime with tdjx::util::cpu_has_avx2().
+// msvc lets any function use avx2 intrinsics, gcc and clang need the function itself marked for the target.
+// fma is left out on purpose so results stay bit for bit the same as the scalar code (no contracted multiply adds).
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TDJX_TARGET_AVX2
+#else
+#define TDJX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
\ No newline at end of file
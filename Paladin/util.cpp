@@ -1,5 +1,7 @@
 #include "util.h"
 
+#include <algorithm>
+
 uint32_t tdjx::util::next_pow2(uint32_t value)
 {
     return (value == 1) ? 1 : 1 << (32 - clz(value));
@@ -71,4 +73,94 @@ inline uint64_t tdjx::util::clzl(uint64_t value)
         return 64;
     }
 }
-#endif
\ No newline at end of file
+#endif
+
+#ifdef _WIN32
+#include <intrin.h>
+static bool query_avx2()
+{
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+
+    // avx needs os support for saving ymm registers, checked through xgetbv
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+}
+#else
+static bool query_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+bool tdjx::util::cpu_has_avx2()
+{
+    static const bool s_hasAvx2 = query_avx2();
+    return s_hasAvx2;
+}
+
+void tdjx::util::radix_sort(uint32_t* keys, uint32_t* values, uint32_t* scratchKeys, uint32_t* scratchValues, int count)
+{
+    // every pass' histogram in one read of the keys
+    uint32_t counts[4][256] = {};
+    for (int i = 0; i < count; ++i)
+    {
+        uint32_t key = keys[i];
+        ++counts[0][key & 0xff];
+        ++counts[1][(key >> 8) & 0xff];
+        ++counts[2][(key >> 16) & 0xff];
+        ++counts[3][key >> 24];
+    }
+
+    uint32_t* sourceKeys = keys;
+    uint32_t* sourceValues = values;
+    uint32_t* destKeys = scratchKeys;
+    uint32_t* destValues = scratchValues;
+
+    for (int pass = 0; pass < 4; ++pass)
+    {
+        int shift = pass * 8;
+        uint32_t* histogram = counts[pass];
+        if (count == 0 || histogram[(sourceKeys[0] >> shift) & 0xff] == static_cast<uint32_t>(count))
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit)
+        {
+            uint32_t n = histogram[digit];
+            histogram[digit] = offset;
+            offset += n;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            uint32_t slot = histogram[(sourceKeys[i] >> shift) & 0xff]++;
+            destKeys[slot] = sourceKeys[i];
+            destValues[slot] = sourceValues[i];
+        }
+
+        std::swap(sourceKeys, destKeys);
+        std::swap(sourceValues, destValues);
+    }
+
+    if (sourceKeys != keys)
+    {
+        std::copy(sourceKeys, sourceKeys + count, keys);
+        std::copy(sourceValues, sourceValues + count, values);
+    }
+}
@@ -13,6 +13,14 @@ namespace tdjx
         uint64_t ctzl(uint64_t value);
         uint64_t clzl(uint64_t value);
 
+        // runtime cpu feature checks, cached after the first call
+        bool cpu_has_avx2();
+
+        // stable lsd radix sort of count keys ascending, values move with their keys. a byte per pass, passes where
+        // every key has the same byte are skipped. the scratch arrays need count entries, the result ends up back in
+        // keys and values
+        void radix_sort(uint32_t* keys, uint32_t* values, uint32_t* scratchKeys, uint32_t* scratchValues, int count);
+
         template <typename t_type>
         inline bool is_pow2(t_type value)
         {
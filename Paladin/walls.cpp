@@ -0,0 +1,238 @@
+#include "walls.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "tdjx_jobs.h"
+
+namespace tdjx
+{
+    namespace walls
+    {
+        const int kFixedShift = 16;
+
+        // walls right up against the camera are clamped to this many screens tall so the step never hits zero
+        const int kMaxHeightScale = 64;
+
+        // screen columns per job
+        const int kColumnBand = 16;
+
+        // what a screen column draws, lineHeight 0 for no wall
+        struct Column
+        {
+            int tile;
+            int side;
+            int u;
+            int lineHeight;
+        };
+
+        struct
+        {
+            std::vector<Column> columns;
+            std::vector<int> missing;
+        } g_walls;
+
+        bool try_create(Walls& out, gfx::ImageHandle sheet, int tileSize, int shadeLevels, float32 shadeDistance)
+        {
+            const gfx::ByteImage* image = gfx::get_image(sheet);
+            if (!image || tileSize <= 0 || image->width < tileSize || image->height < tileSize)
+            {
+                printf("Wall sheet doesn't hold a single %dx%d tile.\n", tileSize, tileSize);
+                return false;
+            }
+
+            out = Walls();
+            out.tileSize = tileSize;
+            out.tileCount = (image->width / tileSize) * (image->height / tileSize);
+
+            int tilesPerRow = image->width / tileSize;
+            out.texels.resize(out.tileCount * tileSize * tileSize);
+            uint8* texel = out.texels.data();
+            for (int tile = 0; tile < out.tileCount; ++tile)
+            {
+                int tileX = (tile % tilesPerRow) * tileSize;
+                int tileY = (tile / tilesPerRow) * tileSize;
+                for (int u = 0; u < tileSize; ++u)
+                {
+                    for (int v = 0; v < tileSize; ++v)
+                    {
+                        *texel++ = image->data[tileX + u + (tileY + v) * image->width];
+                    }
+                }
+            }
+
+            out.shadeLevels = std::max(1, shadeLevels);
+            out.shades = gfx::create_shade_table(out.shadeLevels);
+            out.shadeDistance = shadeDistance;
+            return true;
+        }
+
+        // the distance comes back out of the height, everything at one height shades the same and can share a strip
+        int get_shade_level(const Walls& self, int lineHeight, int screenHeight, int side)
+        {
+            float32 distance = static_cast<float32>(screenHeight) / lineHeight;
+            int level = static_cast<int>(distance / self.shadeDistance * self.shadeLevels);
+
+            // faces across x a shade darker so corners read
+            if (side == 0)
+            {
+                ++level;
+            }
+            return std::min(level, self.shadeLevels - 1);
+        }
+
+        int get_strip_index(int tile, int side, int lineHeight)
+        {
+            return (tile * 2 + side) * kMaxCachedHeight + lineHeight - 1;
+        }
+
+        // cached walls are never clipped, which is what lets them come straight out of the strip
+        bool is_cached(int lineHeight, int screenHeight)
+        {
+            return lineHeight <= kMaxCachedHeight && lineHeight <= screenHeight;
+        }
+
+        // count pixels of texture column u scaled to lineHeight, starting skip pixels down
+        void scale_column(const Walls& self, const Column& column, int screenHeight, int skip, int count,
+            uint8* dest, int destStride)
+        {
+            const uint8* shade = self.shades.data() + get_shade_level(self, column.lineHeight, screenHeight, column.side) * 256;
+            const uint8* texels = self.texels.data() + (column.tile * self.tileSize + column.u) * self.tileSize;
+
+            uint32 step = (static_cast<uint32>(self.tileSize) << kFixedShift) / column.lineHeight;
+            uint32 v = static_cast<uint32>(skip) * step;
+            for (int i = 0; i < count; ++i)
+            {
+                *dest = shade[texels[v >> kFixedShift]];
+                dest += destStride;
+                v += step;
+            }
+        }
+
+        void draw(Walls& self, const raycast::Grid& grid, const raycast::Hits& hits,
+            float32 dirX, float32 dirY, float32 planeX, float32 planeY,
+            uint8* pixels, int columnStride, int rowStride, int height)
+        {
+            int count = static_cast<int>(hits.distance.size());
+            self.top.resize(count);
+            self.bottom.resize(count);
+            if (count == 0 || height <= 0)
+            {
+                return;
+            }
+
+            if (self.stripScreenHeight != height)
+            {
+                self.strips.assign(self.tileCount * 2 * kMaxCachedHeight, std::vector<uint8>());
+                self.stripScreenHeight = height;
+            }
+
+            // work out every column up front and set aside room for any strips that haven't been needed before
+            g_walls.columns.resize(count);
+            g_walls.missing.clear();
+            for (int x = 0; x < count; ++x)
+            {
+                Column& column = g_walls.columns[x];
+                float32 distance = hits.distance[x];
+                float32 maxHeight = static_cast<float32>(height * kMaxHeightScale);
+                column.lineHeight = (distance >= raycast::kMiss) ? 0 :
+                    (distance > 0) ? static_cast<int>(std::min(height / distance, maxHeight)) : height * kMaxHeightScale;
+
+                int top = (height - column.lineHeight) / 2;
+                self.top[x] = std::max(top, 0);
+                self.bottom[x] = std::min(top + column.lineHeight, height);
+                if (column.lineHeight <= 0)
+                {
+                    self.bottom[x] = self.top[x];
+                    continue;
+                }
+
+                // spans still come out without a sheet so the floor and ceiling go in the right places
+                if (self.tileCount == 0)
+                {
+                    continue;
+                }
+
+                column.side = hits.side[x];
+                column.tile = raycast::grid::get_cell(grid, hits.cellX[x], hits.cellY[x]) % self.tileCount;
+                column.u = std::clamp(static_cast<int>(hits.u[x] * self.tileSize), 0, self.tileSize - 1);
+
+                // keep textures reading left to right whichever way the face looks
+                float32 c = static_cast<float32>(2 * x + 1) / count - 1.0f;
+                float32 dx = dirX + planeX * c;
+                float32 dy = dirY + planeY * c;
+                if ((column.side == 0 && dx > 0) || (column.side == 1 && dy < 0))
+                {
+                    column.u = self.tileSize - 1 - column.u;
+                }
+
+                if (is_cached(column.lineHeight, height))
+                {
+                    int index = get_strip_index(column.tile, column.side, column.lineHeight);
+                    if (self.strips[index].empty())
+                    {
+                        self.strips[index].resize(self.tileSize * column.lineHeight);
+                        g_walls.missing.push_back(x);
+                    }
+                }
+            }
+
+            if (self.tileCount == 0)
+            {
+                return;
+            }
+
+            jobs::parallel_for(0, static_cast<int>(g_walls.missing.size()), 1, [&](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    Column column = g_walls.columns[g_walls.missing[i]];
+                    std::vector<uint8>& strip = self.strips[get_strip_index(column.tile, column.side, column.lineHeight)];
+                    for (column.u = 0; column.u < self.tileSize; ++column.u)
+                    {
+                        scale_column(self, column, height, 0, column.lineHeight, strip.data() + column.u * column.lineHeight, 1);
+                    }
+                }
+            });
+
+            jobs::parallel_for(0, count, kColumnBand, [&](int begin, int end)
+            {
+                for (int x = begin; x < end; ++x)
+                {
+                    const Column& column = g_walls.columns[x];
+                    int top = self.top[x];
+                    int rows = self.bottom[x] - top;
+                    if (rows <= 0)
+                    {
+                        continue;
+                    }
+
+                    uint8* dest = pixels + x * columnStride + top * rowStride;
+                    if (is_cached(column.lineHeight, height))
+                    {
+                        const uint8* source = self.strips[get_strip_index(column.tile, column.side, column.lineHeight)].data() +
+                            column.u * column.lineHeight;
+                        if (rowStride == 1)
+                        {
+                            std::memcpy(dest, source, rows);
+                        }
+                        else
+                        {
+                            for (int y = 0; y < rows; ++y, dest += rowStride)
+                            {
+                                *dest = source[y];
+                            }
+                        }
+                    }
+                    else
+                    {
+                        int skip = top - (height - column.lineHeight) / 2;
+                        scale_column(self, column, height, skip, rows, dest, rowStride);
+                    }
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+#include "tdjx_gfx.h"
+#include "raycast.h"
+
+// textured walls for the raycaster. every column steps down its texture column in 16.16 fixed point so there's no
+// divide or multiply per pixel, and distance shading goes through palette shade tables picked per column. a wall's
+// on screen height decides its shade as well as its scale, so for walls short enough to fit on screen whole columns
+// get prescaled and shaded once into a cache (every texture column at that height for that texture and side) and
+// most columns after that are a straight copy out of it.
+
+namespace tdjx
+{
+    namespace walls
+    {
+        // wall heights up to this get cached, closer walls step through the texture directly
+        const int kMaxCachedHeight = 256;
+
+        struct Walls
+        {
+            // the sheet's square tiles (left to right, top to bottom) a column at a time so stepping down a texture
+            // column is contiguous. a cell of value c uses tile c % tileCount
+            std::vector<uint8> texels;
+            int tileSize = 0;
+            int tileCount = 0;
+
+            // see gfx::create_shade_table, walls are at their darkest this far away
+            std::vector<uint8> shades;
+            int shadeLevels = 0;
+            float32 shadeDistance = 0;
+
+            // prescaled columns per tile, side and height, built the first time they're needed. each entry holds
+            // every texture column at that height one after another. they're only good for one screen height
+            std::vector<std::vector<uint8>> strips;
+            int stripScreenHeight = 0;
+
+            // wall span of each column from the last draw, rows [top, bottom)
+            std::vector<int> top;
+            std::vector<int> bottom;
+        };
+
+        bool try_create(Walls& out, gfx::ImageHandle sheet, int tileSize, int shadeLevels, float32 shadeDistance);
+
+        // the view and hits from raycast::cast_columns. pixel (x, y) is pixels[x * columnStride + y * rowStride] so
+        // this draws into a column-major canvas (copies) as well as the screen. only the wall spans get written
+        void draw(Walls& self, const raycast::Grid& grid, const raycast::Hits& hits,
+            float32 dirX, float32 dirY, float32 planeX, float32 planeY,
+            uint8* pixels, int columnStride, int rowStride, int height);
+    }
+}